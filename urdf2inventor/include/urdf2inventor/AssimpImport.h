@@ -28,16 +28,73 @@
 #include <Inventor/nodes/SoSeparator.h>
 #include <Inventor/nodes/SoMaterial.h>
 #include <assimp/scene.h>
+#include <baselib_binding/SharedPtr.h>
+#include <urdf2inventor/MeshConversionOptions.h>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
+namespace Assimp
+{
+class Importer;
+}
+
+/**
+ * The triangle strips and the simplified levels of detail of one mesh of a scene, see prepareScene().
+ */
+struct PreparedMesh
+{
+    //Indices for SoIndexedTriangleStripSet, empty if the mesh is not converted to triangle strips
+    std::vector<int32_t> strips;
+    //Simplified levels of detail with their strips, and the index of the level in MeshConversionOptions::lodRatios
+    std::vector<baselib_binding::shared_ptr<aiMesh>::type> levels;
+    std::vector<std::vector<int32_t> > levelStrips;
+    std::vector<unsigned int> levelRatios;
+};
+
+//One PreparedMesh per mesh of the scene, in the order of aiScene::mMeshes
+typedef std::vector<PreparedMesh> PreparedScene;
+
+/**
+ * Does the expensive parts of Assimp2Inventor() which only work on the Assimp meshes: builds the
+ * triangle strips and simplifies the levels of detail of all meshes, according to \e options.
+ * No Coin nodes are created, so this can run concurrently with conversions in other threads.
+ */
+void prepareScene(const aiScene *const scene, const urdf2inventor::MeshConversionOptions& options,
+                  PreparedScene& prepared);
+
 /**
  * \param materialOverride can be used to override ALL NODES material properties to given values.
+ * \param options the shape nodes which triangle meshes are converted to (SoIndexedFaceSet, or
+ *      SoIndexedTriangleStripSet with strips built from triangles sharing an edge), the levels
+ *      of detail which are generated for them, and the directory to which compressed embedded textures
+ *      are extracted. Uncompressed embedded textures are set as image of the texture nodes.
+ *      The import options are not used here.
+ * \param prepared the result of prepareScene() for \e scene with the same \e options,
+ *      or NULL to prepare the scene here.
  */
-SoSeparator *Assimp2Inventor(const aiScene *const scene, const std::string& sceneDir, const SoMaterial * materialOverride);
+SoSeparator *Assimp2Inventor(const aiScene *const scene, const std::string& sceneDir, const SoMaterial * materialOverride,
+                             const urdf2inventor::MeshConversionOptions& options = urdf2inventor::MeshConversionOptions(),
+                             const PreparedScene * prepared = NULL);
 
-std::vector<std::string> assimpImportedExtensions();
+/**
+ * Returns an importer from a process-wide pool of importers. The importer is not used by
+ * any other thread until the returned pointer is released: then the scene it has imported
+ * is freed and the importer is returned to the pool, so it can be re-used without having
+ * to construct a new importer (which registers all loaders and post-processing steps).
+ * Properties set on the importer are kept when it is re-used.
+ */
+baselib_binding::shared_ptr<Assimp::Importer>::type getPooledImporter();
 
-std::vector<std::pair<std::string, std::vector<std::string> > > assimpImportedFormats();
+/**
+ * Returns the file extensions supported by Assimp. The list is only determined once per process.
+ */
+const std::vector<std::string>& assimpImportedExtensions();
+
+/**
+ * Returns the formats supported by Assimp together with their file extensions.
+ * The list is only determined once per process.
+ */
+const std::vector<std::pair<std::string, std::vector<std::string> > >& assimpImportedFormats();
 
 #endif // ASSIMP_IMPORT_H
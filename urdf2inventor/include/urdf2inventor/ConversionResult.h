@@ -33,6 +33,7 @@
 #define URDF2INVENTOR_CONVERSIONRESULT_H
 // Copyright Jennifer Buehler
 
+#include <urdf2inventor/MeshConversionOptions.h>
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 #include <string>
@@ -57,11 +58,14 @@ public:
                                   const EigenTransform& _addVisualTransform):
         rootLinkName(_rootLinkName),
         material(_material),
-        addVisualTransform(_addVisualTransform) {}
+        addVisualTransform(_addVisualTransform),
+        numThreads(1) {}
     ConversionParameters(const ConversionParameters& o):
         rootLinkName(o.rootLinkName),
         material(o.material),
-        addVisualTransform(o.addVisualTransform) {}
+        addVisualTransform(o.addVisualTransform),
+        numThreads(o.numThreads),
+        meshOptions(o.meshOptions) {}
 
     virtual ~ConversionParameters() {}
 
@@ -79,6 +83,12 @@ public:
      */
     EigenTransform addVisualTransform;
 
+    // number of threads to convert the meshes with, see MeshConvertRecursionParams::numThreads
+    unsigned int numThreads;
+
+    // options for the conversion of the mesh files
+    MeshConversionOptions meshOptions;
+
 private:
     ConversionParameters() {}
 };
@@ -32,7 +32,12 @@
 #define URDF2INVENTOR_CONVERTMESH_H
 
 #include <urdf2inventor/MeshConvertRecursionParams.h>
+#include <urdf2inventor/MeshCache.h>
+#include <urdf2inventor/MeshConversionOptions.h>
 #include <urdf_traverser/Types.h>
+#include <Inventor/nodes/SoNode.h>
+#include <map>
+#include <string>
 
 // this is a temporary filename (extension .iv) which is needed for internal usage, but can be deleted after execution.
 #define TMP_FILE_IV "/tmp/urdf2inventor_tmp.iv"
@@ -80,6 +85,13 @@ bool convertMeshesSimple(urdf_traverser::UrdfTraverser& traverser,
  * mesh files container.
  * Results will be in \e meshParams.
  *
+ * If MeshConvertRecursionParams::numThreads is larger than 1, the links are converted in parallel:
+ * the mesh files of the links are imported with Assimp, and their triangle strips and levels of detail
+ * are built, by several threads at a time, while the conversion to Coin scene graphs (Coin is not
+ * thread-safe) and writing them is done by one thread at a time.
+ * The results are merged in the order of the traversal and are the same as when converting
+ * with one thread.
+ *
  * Note that this template function is only instantiated for MeshFormat=std::string at this point,
  * which means returned meshes can be represented in a string (eg. XML format).
  */
@@ -125,6 +137,14 @@ bool fixTextureReferences(const std::string& relModelDir,
 
 
 
+/**
+ * Mesh nodes which have been converted already, indexed by the mesh file and the settings
+ * of the conversion (scale factor and material). Used in getAllGeometry() to share
+ * one node between all uses of the same mesh.
+ * The nodes are owned by the scene graph they have been added to.
+ */
+typedef std::map<std::string, SoNode*> SharedMeshNodes;
+
 /**
  * Get the mesh from link, scale it up by scale_factor, and pack it into an SoNode which is also respects the
  * scale_factor in its translations
@@ -135,11 +155,21 @@ bool fixTextureReferences(const std::string& relModelDir,
  *      introduced in converting meshes from one format to the other, losing orientation information
  *      (for example, .dae has an "up vector" definition which may have been ignored)
  * \param useVisuals true to use the visuals as base for the geometry, false if the collision geometry should be used instead.
+ * \param options options for the conversion of the mesh files.
+ * \param meshCache if not NULL, meshes which have been converted before with the same settings are
+ *      taken from this cache instead of converting them again, and newly converted meshes are added to it.
+ * \param sharedMeshes if not NULL, meshes which are in \e sharedMeshes already are not converted
+ *      again, instead the same node is added to the scene graph again (multiple parents).
+ *      Written to a file, the node is then defined once and referenced with USE.
+ *      Newly converted meshes are added to \e sharedMeshes.
  */
 SoNode * getAllGeometry(const urdf_traverser::LinkPtr link, double scale_factor,
                        const urdf_traverser::EigenTransform& addTransform,
                        const bool useVisuals,
-                       const bool scaleUrdfTransforms); // default: false
+                       const bool scaleUrdfTransforms, // default: false
+                       const MeshConversionOptions& options = MeshConversionOptions(),
+                       const MeshCachePtr& meshCache = MeshCachePtr(),
+                       SharedMeshNodes * sharedMeshes = NULL);
 
 /**
  * Removes all texture copies in the nodes.
@@ -68,7 +68,8 @@ public:
      * \param _outputDir directory where to save the files.
      */
     explicit FileIO(const std::string& _outputDir):
-        outputDir(_outputDir) {}
+        outputDir(_outputDir),
+        textureInstall(MeshConversionOptions::TEXTURE_COPY) {}
 
     virtual ~FileIO()
     {
@@ -87,6 +88,14 @@ public:
      */
     bool initOutputDir(const std::string& robotName) const;
 
+    /**
+     * Sets whether write() copies the texture files or links them
+     */
+    void setTextureInstall(const MeshConversionOptions::TextureInstall install)
+    {
+        textureInstall = install;
+    }
+
 
 protected:
     bool writeMeshFiles(const std::map<std::string, MeshFormat>& meshes,
@@ -117,6 +126,7 @@ protected:
     }
 private:
     std::string outputDir;
+    MeshConversionOptions::TextureInstall textureInstall;
 };
 }  //  namespace urdf2inventor
 
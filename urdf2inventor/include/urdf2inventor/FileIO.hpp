@@ -86,6 +86,6 @@ bool urdf2inventor::FileIO<MeshFormat>::write(const ConversionResultPtr& data) c
         return false;
     }
 
-    urdf2inventor::helpers::writeFiles(data->textureFiles, outputDir);
+    urdf2inventor::helpers::writeFiles(data->textureFiles, outputDir, textureInstall);
     return writeImpl(data);
 }
@@ -42,6 +42,8 @@
 #include <string>
 
 #include <urdf_traverser/Helpers.h>
+#include <urdf_traverser/PathTable.h>
+#include <urdf2inventor/MeshConversionOptions.h>
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 #include <urdf/model.h>
@@ -65,17 +67,31 @@ extern void resetStdOut();
 // see http://homepage.ntlworld.com/jonathan.deboynepollard/FGA/redirecting-standard-io.html
 extern void redirectStdOut(const char * toFile);
 
+/**
+ * 64 bit FNV-1a hash of the \e size bytes at \e data, as hexadecimal string.
+ */
+extern std::string hashData(const char * data, const size_t size);
+
 /**
  * Copies all files as given in \e files to the target directory \e outputDir.
  * Will copy all files i ``<mapIterator->second[i]>`` to ``<output-dir>/<mapIterator->first>``.
+ * The target directories are created first, then the files are installed with \e numThreads threads.
+ * Files which are already up to date (a copy with the same size and modification time
+ * as the original, or a link to it) are skipped. If several targets have the same
+ * source file (the same inode, e.g. when it is referred to through symbolic links), it is only
+ * read once: when copying, the other targets are hard links to the first copy.
  *
  * \param files The file names to copy to target directories:
  *      Map **key** is the path to the file.
  *      It may be an absolute path, in which case \e outputDir is ignored. Or it may
  *      be a relative path, in which case the file is saved relative to \e outputDir.
  *      Map **value** is a list of *absolute* filenames of files to copy into this directory.
+ * \param install whether to copy the files or to link them (see MeshConversionOptions::TextureInstall)
+ * \param numThreads number of threads to install the files with, 0 for the number of hardware threads.
  */
-extern bool writeFiles(const std::map<std::string, std::set<std::string> >& files, const std::string& outputDir);
+extern bool writeFiles(const std::map<std::string, std::set<std::string> >& files, const std::string& outputDir,
+                       const MeshConversionOptions::TextureInstall install = MeshConversionOptions::TEXTURE_COPY,
+                       unsigned int numThreads = 0);
 
 /**
  *  All file references in the model \e modelString (to be saved in \e modelDir)
@@ -104,6 +120,8 @@ extern bool writeFiles(const std::map<std::string, std::set<std::string> >& file
  *              If the path is not a common parent path of all files in \e filesInUse, the method returns false.
  * \param filesInUse all files which are referenced from within the model. This should be absolute paths!
  * \param modelString the string representation (eg. XML) of the model which is to be adjusted (fixing file references).
+ *      If it is in the binary inventor format, the model is read, its texture references are changed
+ *      and it is written again, since strings in binary content can't be replaced.
  * \param filesToCopy The file names to copy to target directories:
  *      Map **key** is the path to the output file directory, which will be located in
  *      the global output directory (eg. ``<fileDir>/path/to/file``). So if \e fileDir was given as absolute path, this path
@@ -111,6 +129,9 @@ extern bool writeFiles(const std::map<std::string, std::set<std::string> >& file
  *      Map **value** is a list of *absolute* filenames to copy into this directory.
  *      So copying *all* files i ``<mapIterator->second[i]>`` to ``<output-dir>/<mapIterator->first>`` will be
  *      required when installing the model file \e modelString to ``<output-dir>/<filename>.<extension>``.
+ * \param pathTable the table to do the path computations with. When fixing the references of many models,
+ *      one table should be used for all of them, so that each path is only split once. If NULL, a
+ *      table is created for this call.
  * \return false if no common parent directory could be determined for all of the files and/or the common parent is
  *      no subdirectory of \e fileRootDir.
  */
@@ -119,7 +140,23 @@ extern bool fixFileReferences(const std::string& modelDir,
                               const std::string& fileRootDir,
                               const std::set<std::string>& filesInUse,
                               std::string& modelString,
-                              std::map<std::string, std::set<std::string> >& filesToCopy);
+                              std::map<std::string, std::set<std::string> >& filesToCopy,
+                              urdf_traverser::helpers::PathTable * pathTable = NULL);
+
+/**
+ * Determines the new references of the files in \e filesInUse, as used by fixFileReferences(),
+ * without changing a model. This can be used to change the references in a scene graph
+ * before it is written (see urdf2inventor::setTexturePaths()).
+ * For a description of the parameters see fixFileReferences().
+ * \param newReferences the new reference for each of the \e filesInUse, relative to \e modelDir.
+ */
+extern bool getFileReferences(const std::string& modelDir,
+                              const std::string& fileDir,
+                              const std::string& fileRootDir,
+                              const std::set<std::string>& filesInUse,
+                              std::map<std::string, std::string>& newReferences,
+                              std::map<std::string, std::set<std::string> >& filesToCopy,
+                              urdf_traverser::helpers::PathTable * pathTable = NULL);
 
 
 
@@ -37,7 +37,9 @@
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
+#include <map>
 #include <set>
+#include <string>
 
 namespace urdf2inventor
 {
@@ -122,11 +124,43 @@ extern void addLocalAxes(SoSeparator * addToNode, float axesRadius, float axesLe
  */
 extern std::set<std::string> getAllTexturePaths(SoNode * root);
 
+/**
+ * Changes the file names of all SoTexture2 nodes which reference one of the files
+ * (absolute paths, as returned by getAllTexturePaths()) in the keys of \e newPaths
+ * to the value in \e newPaths. The textures are not re-loaded from the new file names.
+ * \return the number of texture nodes which were changed
+ */
+extern unsigned int setTexturePaths(SoNode * root, const std::map<std::string, std::string>& newPaths);
+
 /**
  * writes the contents of SoNode into the inventor (*.iv) format and returns the file
- * content as a string.
+ * content as a string. The content is written directly into \e result, which is presized
+ * to an estimate of the content size.
+ * \param binary write the binary inventor format instead of ASCII. Binary content can
+ *      contain null characters, and strings in it must not be replaced, as they are
+ *      stored together with their length.
+ */
+extern bool writeInventorFileString(SoNode * node, std::string& result, bool binary = false);
+
+/**
+ * Writes the contents of SoNode directly into the inventor (*.iv) file \e filename,
+ * without keeping the content in memory. The directory of the file is created if needed.
+ * \param binary write the binary inventor format instead of ASCII
+ */
+extern bool writeInventorFile(SoNode * node, const std::string& filename, bool binary = false);
+
+/**
+ * \return true if the inventor file content \e content is in the binary format
+ */
+extern bool isBinaryInventorContent(const std::string& content);
+
+/**
+ * Reads the inventor (*.iv) file content \e content, as written by writeInventorFileString().
+ * If the content has only one top-level node, this node is returned, otherwise a separator
+ * containing all top-level nodes. The reference count of the returned node is 0.
+ * \return NULL if the content could not be read.
  */
-extern bool writeInventorFileString(SoNode * node, std::string& result);
+extern SoNode * readInventorFileString(const std::string& content);
 
 
 
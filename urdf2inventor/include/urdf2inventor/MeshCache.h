@@ -0,0 +1,148 @@
+/**
+ * <ORGANIZATION> = Jennifer Buehler 
+ * <COPYRIGHT HOLDER> = Jennifer Buehler 
+ * 
+ * Copyright (c) 2016 Jennifer Buehler 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <ORGANIZATION> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ------------------------------------------------------------------------------
+ **/
+
+#ifndef URDF2INVENTOR_MESHCACHE_H
+#define URDF2INVENTOR_MESHCACHE_H
+// Copyright Jennifer Buehler
+
+#include <baselib_binding/SharedPtr.h>
+
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace urdf2inventor
+{
+
+/**
+ * \brief Cache for meshes which have been converted to the inventor format.
+ *
+ * The converted meshes are stored as inventor (*.iv) file content, indexed by a key which
+ * is computed from the *contents* of the mesh file and a string describing the settings
+ * of the conversion (see getKey()). A mesh which is referenced from several links, or
+ * from several models sharing the same mesh files, therefore only has to be converted once.
+ *
+ * The converted meshes are kept in memory for the lifetime of the cache object. If a cache
+ * directory is given, they are also written to ``<cache-directory>/<key>.iv``, so that they
+ * can be re-used by later runs of the conversion.
+ *
+ * Note that the cached meshes reference texture files with absolute paths, so the textures
+ * are still read from their original location. Everything which determines these paths (like
+ * the directory the texture paths in the mesh file are resolved against) therefore has to be
+ * part of the settings.
+ *
+ * All methods are thread-safe.
+ *
+ * \author Jennifer Buehler
+ */
+class MeshCache
+{
+public:
+    /**
+     * \param cacheDirectory directory in which the converted meshes are stored across runs,
+     *      or empty to only keep them in memory. The directory is created when the first
+     *      mesh is added.
+     */
+    explicit MeshCache(const std::string& cacheDirectory = ""):
+        directory(cacheDirectory) {}
+
+    ~MeshCache() {}
+
+    const std::string& getDirectory() const
+    {
+        return directory;
+    }
+
+    /**
+     * Computes the key under which the conversion of mesh file \e meshFilename with
+     * the conversion settings \e settings is stored. Converting the same file contents with
+     * the same settings must always lead to the same result, including the paths of referenced textures.
+     * The hash of the file contents is only computed again if the modification time or
+     * size of the file has changed.
+     * \return false if the mesh file could not be read.
+     */
+    bool getKey(const std::string& meshFilename, const std::string& settings, std::string& key);
+
+    /**
+     * \return true if there is a converted mesh for \e key, in memory or in the cache directory.
+     */
+    bool has(const std::string& key);
+
+    /**
+     * Gets the converted mesh stored under \e key. If it is not in memory yet, it is read
+     * from the cache directory.
+     * \return false if there is no converted mesh for \e key.
+     */
+    bool get(const std::string& key, std::string& ivContent);
+
+    /**
+     * Adds the converted mesh \e ivContent under the \e key, and writes it to the cache
+     * directory if there is one.
+     * \return false if the mesh could not be written to the cache directory. It is still
+     *      kept in memory in this case.
+     */
+    bool add(const std::string& key, const std::string& ivContent);
+
+    /**
+     * Removes all meshes from memory. Files in the cache directory are kept.
+     */
+    void clear();
+
+private:
+    /**
+     * Hash of the contents of a mesh file, and the modification time and size of
+     * the file at the time the hash was computed.
+     */
+    struct FileHash
+    {
+        std::time_t modificationTime;
+        unsigned long long size;
+        std::string hash;
+    };
+
+    std::string getCacheFilename(const std::string& key) const;
+
+    std::string directory;
+
+    // the converted meshes, indexed by their key
+    std::map<std::string, std::string> meshes;
+
+    // the hashes of the mesh files, indexed by the absolute file name
+    std::map<std::string, FileHash> fileHashes;
+
+    std::mutex mutex;
+};
+
+typedef baselib_binding::shared_ptr<MeshCache>::type MeshCachePtr;
+
+}  // namespace urdf2inventor
+#endif   // URDF2INVENTOR_MESHCACHE_H
@@ -0,0 +1,171 @@
+/**
+ * <ORGANIZATION> = Jennifer Buehler 
+ * <COPYRIGHT HOLDER> = Jennifer Buehler 
+ * 
+ * Copyright (c) 2016 Jennifer Buehler 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <ORGANIZATION> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ------------------------------------------------------------------------------
+ **/
+
+#ifndef URDF2INVENTOR_MESHCONVERSIONOPTIONS_H
+#define URDF2INVENTOR_MESHCONVERSIONOPTIONS_H
+// Copyright Jennifer Buehler
+
+#include <string>
+#include <vector>
+
+namespace urdf2inventor
+{
+
+/**
+ * \brief Options for the conversion of the mesh files to the inventor format.
+ * \author Jennifer Buehler
+ */
+class MeshConversionOptions
+{
+public:
+    // Shape nodes which triangle meshes are converted to
+    enum TriangleShape
+    {
+        // SoIndexedTriangleStripSet, with strips built from adjacent triangles
+        TRIANGLE_STRIPS,
+        // SoIndexedFaceSet with one face per triangle
+        FACE_SET
+    };
+
+    // Presets of post-processing steps which Assimp applies to the meshes after importing them
+    enum PostProcessing
+    {
+        // "none": only merge the nodes of the scene graph and remove invalid data
+        POSTPROCESS_NONE,
+        // "fast" (default): in addition, triangulate polygons (which can't be converted otherwise)
+        // and split meshes with different primitive types. This is cheap.
+        POSTPROCESS_FAST,
+        // "render-optimized": in addition to "fast", join identical vertices, remove degenerate
+        // triangles, merge meshes and reorder the triangles for vertex cache locality.
+        POSTPROCESS_RENDER_OPTIMIZED,
+        // "collision-minimal": like "render-optimized" without the reordering, but also removes
+        // normals, texture coordinates, colors, textures, points and lines, for collision geometry.
+        POSTPROCESS_COLLISION_MINIMAL
+    };
+
+    // How the texture files are installed in the output directory
+    enum TextureInstall
+    {
+        // "copy" (default): copy the files
+        TEXTURE_COPY,
+        // "hardlink": hard links to the original files. Files on another file system are copied.
+        TEXTURE_HARDLINK,
+        // "symlink": symbolic links to the original files
+        TEXTURE_SYMLINK,
+        // "reflink": copy-on-write clones of the files, which share their data with the original
+        // files until either is changed. Files are copied where the file system doesn't support this.
+        TEXTURE_REFLINK
+    };
+
+    MeshConversionOptions():
+        triangleShape(TRIANGLE_STRIPS),
+        joinIdenticalVertices(false),
+        postProcessing(POSTPROCESS_FAST),
+        binaryOutput(false),
+        textureInstall(TEXTURE_COPY) {}
+
+    /**
+     * Gets the distance from the viewer beyond which level \e level of lodRatios is displayed.
+     * If lodRanges has no entry for this level, the last range given (or 1 if there is none)
+     * is doubled for each further level.
+     */
+    float getLodRange(const unsigned int level) const
+    {
+        if (level < lodRanges.size()) return lodRanges[level];
+        float range = lodRanges.empty() ? 0.5 : lodRanges.back();
+        for (unsigned int i = lodRanges.size(); i <= level; ++i) range *= 2;
+        return range;
+    }
+
+    /**
+     * Gets the preset of post-processing steps from its \e name (see PostProcessing)
+     * \return false if there is no preset of this name
+     */
+    static bool getPostProcessing(const std::string& name, PostProcessing& preset)
+    {
+        if (name == "none") preset = POSTPROCESS_NONE;
+        else if (name == "fast") preset = POSTPROCESS_FAST;
+        else if (name == "render-optimized") preset = POSTPROCESS_RENDER_OPTIMIZED;
+        else if (name == "collision-minimal") preset = POSTPROCESS_COLLISION_MINIMAL;
+        else return false;
+        return true;
+    }
+
+    /**
+     * Gets the way to install the texture files from its \e name (see TextureInstall)
+     * \return false if there is no such way
+     */
+    static bool getTextureInstall(const std::string& name, TextureInstall& install)
+    {
+        if (name == "copy") install = TEXTURE_COPY;
+        else if (name == "hardlink") install = TEXTURE_HARDLINK;
+        else if (name == "symlink") install = TEXTURE_SYMLINK;
+        else if (name == "reflink") install = TEXTURE_REFLINK;
+        else return false;
+        return true;
+    }
+
+    TriangleShape triangleShape;
+
+    // Join identical vertices when importing the meshes (aiProcess_JoinIdenticalVertices),
+    // so that triangles share their vertices. Many mesh formats define the vertices
+    // for each triangle, and triangle strips can only be built of triangles which share vertices.
+    bool joinIdenticalVertices;
+
+    PostProcessing postProcessing;
+
+    // Ratios of the number of triangles of the original mesh (e.g. 0.25, 0.05) to which the triangle
+    // meshes are simplified for lower levels of detail, in decreasing order. If not empty, triangle
+    // meshes are converted to an SoLOD which displays the original mesh close to the viewer and
+    // the simplified meshes further away. Levels which can't be simplified any further are left out.
+    std::vector<float> lodRatios;
+
+    // Distances from the viewer (in the units of the model) beyond which the levels in lodRatios are
+    // displayed, in increasing order. See getLodRange() for the levels which have no range given.
+    std::vector<float> lodRanges;
+
+    // Write the converted meshes and the whole robot in the binary inventor format instead of ASCII.
+    // Binary files are considerably smaller and faster to read.
+    bool binaryOutput;
+
+    // How the texture files which the meshes reference are installed in the output directory
+    TextureInstall textureInstall;
+
+    // Directory to which compressed textures embedded in the mesh files (e.g. PNG or JPEG images
+    // in .glb or .fbx files) are extracted, so that the meshes can reference them like other texture
+    // files. They are named by the hash of their content, so each image is only written once.
+    // If empty, ``<temp-directory>/urdf2inventor_textures`` is used. When a mesh cache directory
+    // is used, this directory should be kept as long as the cache, since cached meshes reference it.
+    std::string embeddedTextureDir;
+};
+
+}  // namespace urdf2inventor
+#endif   // URDF2INVENTOR_MESHCONVERSIONOPTIONS_H
@@ -33,6 +33,8 @@
 #define URDF2INVENTOR_MESHCONVERTRECURSIONPARAMS
 
 #include <urdf_traverser/RecursionParams.h>
+#include <urdf2inventor/MeshCache.h>
+#include <urdf2inventor/MeshConversionOptions.h>
 #include <ros/ros.h>
 #include <set>
 #include <string>
@@ -56,11 +58,15 @@ public:
         FactorRecursionParams(_scale_factor),
         material(_material),
         extension(_extension),
+        numThreads(1),
         addVisualTransform(_addVisualTransform) {}
     MeshConvertRecursionParams(const MeshConvertRecursionParams& o):
         FactorRecursionParams(o),
         material(o.material),
         extension(o.extension),
+        numThreads(o.numThreads),
+        meshCache(o.meshCache),
+        meshOptions(o.meshOptions),
         resultMeshes(o.resultMeshes),
         addVisualTransform(o.addVisualTransform),
         textureFiles(o.textureFiles) {}
@@ -73,6 +79,17 @@ public:
     // will have.
     std::string extension;
 
+    // Number of threads to convert the meshes of the links with. If larger than 1,
+    // the links are converted in parallel (see urdf2inventor::convertMeshes()).
+    // 0 uses as many threads as the hardware supports.
+    unsigned int numThreads;
+
+    // Cache of converted meshes, or NULL to convert all meshes (see urdf2inventor::MeshCache).
+    MeshCachePtr meshCache;
+
+    // Options for the conversion of the mesh files
+    MeshConversionOptions meshOptions;
+
     /**
      * this transform will be post-multiplied the link **visual** (not the link!) local
      * transform (their "origin"). This may be the same transform for all links,
@@ -0,0 +1,61 @@
+/**
+ * <ORGANIZATION> = Jennifer Buehler 
+ * <COPYRIGHT HOLDER> = Jennifer Buehler 
+ * 
+ * Copyright (c) 2016 Jennifer Buehler 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <ORGANIZATION> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ------------------------------------------------------------------------------
+ **/
+
+#ifndef URDF2INVENTOR_MESHSIMPLIFICATION_H
+#define URDF2INVENTOR_MESHSIMPLIFICATION_H
+// Copyright Jennifer Buehler
+
+#include <assimp/mesh.h>
+
+namespace urdf2inventor
+{
+
+/**
+ * Simplifies the triangle mesh to (about) \e targetFaces faces by quadric edge collapse
+ * (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics", 1997).
+ *
+ * Vertices at the same position are joined before the simplification, so that triangles
+ * which don't share their vertices in the mesh (e.g. in STL files) can be simplified as well.
+ * Edges are only collapsed if this does not flip triangles or change the topology of the
+ * mesh, and the borders of open meshes are preserved. The simplification therefore stops
+ * early if no more edges can be collapsed.
+ *
+ * The simplified mesh has no normals, so the normals are generated by Coin (with the
+ * crease angle of the current shape hints). Texture coordinates and colors are taken
+ * from one of the joined vertices, so seams in the texture mapping are not preserved.
+ *
+ * \return the simplified mesh, which the caller has to delete, or NULL if \e mesh is not
+ *      a triangle mesh or already has at most \e targetFaces faces.
+ */
+extern aiMesh * simplifyMesh(const aiMesh * mesh, unsigned int targetFaces);
+
+}  // namespace urdf2inventor
+#endif   // URDF2INVENTOR_MESHSIMPLIFICATION_H
@@ -35,6 +35,8 @@
 //-----------------------------------------------------
 #include <urdf2inventor/ConversionResult.h>
 #include <urdf2inventor/MeshConvertRecursionParams.h>
+#include <urdf2inventor/MeshCache.h>
+#include <urdf2inventor/ConvertMesh.h>
 
 #include <urdf_traverser/UrdfTraverser.h>
 
@@ -153,6 +155,9 @@ public:
      *      introduced in converting meshes from one format to the other, losing orientation information
      *      (for example, .dae has an "up vector" definition which may have been ignored)
      * \param textureFiles if not NULL, a list of all texture files (absolute paths) in use are returned here.
+     *
+     * Meshes which are used several times with the same scale and material are only converted once,
+     * and the same node is used for all of them.
      */
     SoNode * getAsInventor(const std::string& fromLink, bool useScaleFactor,
                            bool addAxes, float axesRadius, float axesLength,
@@ -250,6 +255,36 @@ public:
      */
     void cleanup();
 
+    /**
+     * Sets the cache of converted meshes which is used by convert() and the functions
+     * returning or writing the model in the inventor format. Meshes which are referenced
+     * several times, or have been converted before with the same settings, are then not converted again.
+     * \param cache the cache, or NULL to convert all meshes (default).
+     */
+    void setMeshCache(const MeshCachePtr& cache)
+    {
+        meshCache = cache;
+    }
+
+    const MeshCachePtr& getMeshCache() const
+    {
+        return meshCache;
+    }
+
+    /**
+     * Sets the options for the conversion of the mesh files used by the functions returning or
+     * writing the model in the inventor format. convert() uses ConversionParameters::meshOptions instead.
+     */
+    void setMeshConversionOptions(const MeshConversionOptions& options)
+    {
+        meshOptions = options;
+    }
+
+    const MeshConversionOptions& getMeshConversionOptions() const
+    {
+        return meshOptions;
+    }
+
 protected:
 
     UrdfTraverserPtr getTraverser()
@@ -304,14 +339,17 @@ private:
     /**
      * Recursive function which returns an inventor node for all links down from (and including) from_link.
      * See other getAsInventor() function.
+     * \param sharedMeshes the mesh nodes converted so far, which are re-used for further uses of the same mesh.
      */
     SoNode * getAsInventor(const LinkPtr& from_link, bool useScaleFactor,
                            bool _addAxes, float _axesRadius, float _axesLength,
                            const EigenTransform& addTransform,
-                           std::set<std::string> * textureFiles);
+                           std::set<std::string> * textureFiles,
+                           SharedMeshNodes& sharedMeshes);
 
     /**
-     * Writes the contents of SoNode into the file of given name.
+     * Writes the contents of SoNode into the file of given name, in the binary
+     * format if MeshConversionOptions::binaryOutput is set.
      */
     bool writeInventorFile(SoNode * node, const std::string& filename);
 
@@ -329,6 +367,12 @@ private:
     // The graspit model might ahve to be scaled compared to the urdf model, this is the scale factor which does that.
     float scaleFactor;
     bool isScaled;
+
+    // cache of converted meshes, may be NULL
+    MeshCachePtr meshCache;
+
+    // options for the conversion of the mesh files in getAsInventor()
+    MeshConversionOptions meshOptions;
 };
 
 }  //  namespace urdf2inventor
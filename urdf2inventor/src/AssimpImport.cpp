@@ -24,6 +24,9 @@
 
 #include <ros/ros.h>
 #include <urdf2inventor/AssimpImport.h>
+#include <urdf2inventor/MeshSimplification.h>
+#include <urdf2inventor/Helpers.h>
+#include <urdf_traverser/Helpers.h>
 
 #include <assimp/Importer.hpp>
 #include <assimp/importerdesc.h>
@@ -35,11 +38,19 @@
 #include <Inventor/nodes/SoIndexedPointSet.h>
 #include <Inventor/nodes/SoIndexedLineSet.h>
 #include <Inventor/nodes/SoIndexedTriangleStripSet.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
 #include <Inventor/nodes/SoMaterial.h>
 #include <Inventor/nodes/SoTexture2.h>
+#include <Inventor/nodes/SoLOD.h>
 
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <sstream>
+#include <mutex>
 
 
 SbName getName(const std::string &name)
@@ -128,39 +139,119 @@ SoTransform *getTransform(const aiMatrix4x4 &matrix)
 }
 
 
-SoTexture2 *getTexture(const aiTexture *const texture)
+/**
+ * Sets the pixels of the uncompressed embedded \e texture as image of \e soTexture.
+ */
+void setTextureImage(SoTexture2 *soTexture, const aiTexture *const texture)
 {
-    if (texture->mHeight == 0)  //Compressed texture
+    //Allocate the image and write the pixels directly into it
+    ///The texels are stored as BGRA, so they have to be copied one by one
+    soTexture->image.setValue(SbVec2s(texture->mWidth, texture->mHeight), 4, NULL);
+    SbVec2s size;
+    int numComponents;
+    unsigned char *pixels(soTexture->image.startEditing(size, numComponents));
+    const std::size_t numTexels(static_cast<std::size_t>(texture->mWidth) * texture->mHeight);
+    for (std::size_t i(0); i < numTexels; ++i)
     {
-        std::cout << "Found a compressed embedded texture. "
-                  << "It will be ignored." << std::endl;
-        ///texture->pcData is a pointer to a memory buffer of
-        ///size mWidth containing the compressed texture data
-        ///I do not know how to extract this information
-        return NULL;
+        pixels[4 * i + 0] = texture->pcData[i].r;
+        pixels[4 * i + 1] = texture->pcData[i].g;
+        pixels[4 * i + 2] = texture->pcData[i].b;
+        pixels[4 * i + 3] = texture->pcData[i].a;
     }
-    else    //Uncompressed texture
+    soTexture->image.finishEditing();
+}
+
+/**
+ * Gets the file extension of the compressed embedded \e texture, from the signature
+ * of its data or else from the format hint of Assimp.
+ * \return empty string if the format is unknown
+ */
+std::string getCompressedTextureExtension(const aiTexture *const texture)
+{
+    const unsigned char *data(reinterpret_cast<const unsigned char*>(texture->pcData));
+    if ((texture->mWidth >= 8) && (memcmp(data, "\x89PNG\r\n\x1a\n", 8) == 0)) return "png";
+    if ((texture->mWidth >= 3) && (data[0] == 0xFF) && (data[1] == 0xD8) && (data[2] == 0xFF)) return "jpg";
+
+    std::string hint;
+    for (std::size_t i(0); (i < sizeof(texture->achFormatHint)) && (texture->achFormatHint[i] != '\0'); ++i)
     {
-        unsigned char pixels[texture->mWidth * texture->mHeight * 4];
-        for (std::size_t i(0); i < texture->mWidth; ++i)
-        {
-            for (std::size_t j(0); j < texture->mHeight; ++j)
-            {
-                pixels[4 * (texture->mHeight * i + j) + 0] = texture->pcData[texture->mHeight * i + j].r;
-                pixels[4 * (texture->mHeight * i + j) + 1] = texture->pcData[texture->mHeight * i + j].g;
-                pixels[4 * (texture->mHeight * i + j) + 2] = texture->pcData[texture->mHeight * i + j].b;
-                pixels[4 * (texture->mHeight * i + j) + 3] = texture->pcData[texture->mHeight * i + j].a;
-            }
-        }
-        SoTexture2 *soTexture(new SoTexture2);
-        soTexture->image.setValue(SbVec2s(texture->mWidth, texture->mHeight), 4, pixels);
+        if (!isalnum(texture->achFormatHint[i])) return "";
+        hint += tolower(texture->achFormatHint[i]);
+    }
+    return hint;
+}
 
-        return soTexture;
+/**
+ * Writes the compressed embedded \e texture (e.g. a PNG or JPEG image) to a file in \e dir,
+ * named by the hash of its content. The file is only written if it doesn't exist yet.
+ * \param filename the absolute path of the file
+ */
+bool extractCompressedTexture(const aiTexture *const texture, const std::string& dir, std::string& filename)
+{
+    std::string extension(getCompressedTextureExtension(texture));
+    if (extension.empty())
+    {
+        std::cout << "Found a compressed embedded texture of unknown format. "
+                  << "It will be ignored." << std::endl;
+        return false;
     }
+
+    ///texture->pcData is a pointer to a memory buffer of
+    ///size mWidth containing the compressed texture data
+    const char *data(reinterpret_cast<const char*>(texture->pcData));
+    const std::size_t size(texture->mWidth);
+    std::stringstream name;
+    name << urdf2inventor::helpers::hashData(data, size) << "-" << std::hex << size << "." << extension;
+    filename = boost::filesystem::absolute(boost::filesystem::path(dir) / name.str()).string();
+
+    boost::system::error_code err;
+    if (boost::filesystem::exists(filename, err) && (boost::filesystem::file_size(filename, err) == size))
+        return true;
+
+    if (!urdf_traverser::helpers::makeDirectoryIfNeeded(dir.c_str()))
+    {
+        std::cout << "Could not create directory " << dir << " for embedded textures" << std::endl;
+        return false;
+    }
+    // write to a temporary file first and then rename it, so that other processes
+    // extracting to the same directory never read an incomplete file
+    std::string tmpFilename = boost::filesystem::unique_path(filename + ".%%%%-%%%%-%%%%.tmp").string();
+    std::ofstream out(tmpFilename.c_str(), std::ofstream::out | std::ofstream::binary);
+    out.write(data, size);
+    out.close();
+    if (out.fail())
+    {
+        std::cout << "Could not write embedded texture to " << tmpFilename << std::endl;
+        boost::filesystem::remove(tmpFilename, err);
+        return false;
+    }
+    boost::filesystem::rename(tmpFilename, filename, err);
+    if (err)
+    {
+        std::cout << "Could not move embedded texture to " << filename << ": " << err.message() << std::endl;
+        boost::filesystem::remove(tmpFilename, err);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Gets the directory to which compressed embedded textures are extracted, see
+ * MeshConversionOptions::embeddedTextureDir
+ */
+std::string getEmbeddedTextureDir(const urdf2inventor::MeshConversionOptions& options)
+{
+    if (!options.embeddedTextureDir.empty()) return options.embeddedTextureDir;
+    return (boost::filesystem::temp_directory_path() / "urdf2inventor_textures").string();
 }
 
 
-SoTexture *getTexture(const aiMaterial *const material, const std::string &sceneDir)
+/**
+ * \param textures the textures embedded in the scene, which are referenced with paths ``*<index>``.
+ */
+SoTexture *getTexture(const aiMaterial *const material, const aiTexture *const *const textures,
+                      const unsigned int numTextures, const std::string &sceneDir,
+                      const urdf2inventor::MeshConversionOptions& options)
 {
     ///I only know how to deal with aiTextureType_DIFFUSE textures
     ///and with only one texture.
@@ -177,11 +268,11 @@ SoTexture *getTexture(const aiMaterial *const material, const std::string &scene
     ///It should be related with the loaded info
 
     //Check if there is a texture
-    unsigned int numTextures(material->GetTextureCount(aiTextureType_DIFFUSE));
-    if (numTextures == 0) return NULL;
-    if (numTextures > 1)
+    unsigned int numDiffuse(material->GetTextureCount(aiTextureType_DIFFUSE));
+    if (numDiffuse == 0) return NULL;
+    if (numDiffuse > 1)
     {
-        std::cout << "Found a material with " << numTextures
+        std::cout << "Found a material with " << numDiffuse
                   << " textures. Only the first one will be used." << std::endl;
     }
 
@@ -215,25 +306,57 @@ SoTexture *getTexture(const aiMaterial *const material, const std::string &scene
                   "Property will be ignored." << std::endl;
     }
 
-    SoTexture2 *texture(new SoTexture2);
+    //Get embedded texture
+    const aiTexture *embedded(NULL);
+    if (path.data[0] == '*')
+    {
+        char *end;
+        unsigned long index(strtoul(path.data + 1, &end, 10));
+        if ((*end != '\0') || (end == path.data + 1) || (index >= numTextures))
+        {
+            std::cout << "Invalid reference to embedded texture " << path.C_Str()
+                      << ". Texture will be ignored." << std::endl;
+            return NULL;
+        }
+        embedded = textures[index];
+    }
 
-    //Load image
-    boost::filesystem::path relFilePath(path.C_Str());
-    boost::filesystem::path absPath = relFilePath;
-    if (relFilePath.is_relative())
+    std::string filename;
+    if (!embedded)
+    {
+        boost::filesystem::path relFilePath(path.C_Str());
+        boost::filesystem::path absPath = relFilePath;
+        if (relFilePath.is_relative())
+        {
+            boost::filesystem::path sceneDirPath(sceneDir);
+            absPath = boost::filesystem::canonical(relFilePath, sceneDirPath);
+            // ROS_INFO_STREAM("Absolute file path: "<<absPath.string());
+        }
+
+        // ROS_INFO_STREAM("Clean absolute file path: "<<absPath.string());
+        filename = absPath.string();
+        // ROS_INFO_STREAM("Filename: "<<filename);
+    }
+    else if (embedded->mHeight == 0)  //Compressed texture
     {
-        boost::filesystem::path sceneDirPath(sceneDir);
-        absPath = boost::filesystem::canonical(relFilePath, sceneDirPath);
-        // ROS_INFO_STREAM("Absolute file path: "<<absPath.string());
+        ///Coin can only read compressed images from files, so the texture is
+        ///referenced like a texture file
+        if (!extractCompressedTexture(embedded, getEmbeddedTextureDir(options), filename)) return NULL;
     }
 
-    // ROS_INFO_STREAM("Clean absolute file path: "<<absPath.string());
-    std::string filename = absPath.string();
-    // ROS_INFO_STREAM("Filename: "<<filename);
+    SoTexture2 *texture(new SoTexture2);
 
-    texture->filename.setValue(filename.c_str());///How to check if image was loaded?
-    // texture->setName(getName(boost::filesystem::path(filename).filename().string()));
-    texture->setName(getName(filename));
+    //Load image
+    if (!filename.empty())
+    {
+        texture->filename.setValue(filename.c_str());///How to check if image was loaded?
+        // texture->setName(getName(boost::filesystem::path(filename).filename().string()));
+        texture->setName(getName(filename));
+    }
+    else  //Uncompressed embedded texture
+    {
+        setTextureImage(texture, embedded);
+    }
 
     //Set model
     texture->model.setValue(SoTexture2::DECAL);
@@ -356,7 +479,135 @@ SoMaterial *getMaterial(const aiMaterial *const material)
 }
 
 
-SoIndexedShape *getShape(const aiMesh *const mesh)
+/**
+ * Sets the values of \e field to the \e num vectors \e vectors, writing them directly
+ * into the field's storage. If the Assimp vectors have the same layout as SbVec3f
+ * (which is the case unless Assimp uses double precision), they are copied as a whole.
+ */
+void setVec3Values(SoMFVec3f &field, const aiVector3D *const vectors, const std::size_t num)
+{
+    field.setNum(num);
+    SbVec3f *values(field.startEditing());
+    if ((sizeof(aiVector3D) == sizeof(SbVec3f)) && (sizeof(vectors[0].x) == sizeof(float)))
+    {
+        std::memcpy(static_cast<void*>(values), vectors, num * sizeof(SbVec3f));
+    }
+    else
+    {
+        for (std::size_t i(0); i < num; ++i)
+        {
+            values[i].setValue(vectors[i].x, vectors[i].y, vectors[i].z);
+        }
+    }
+    field.finishEditing();
+}
+
+
+/**
+ * Builds triangle strips from the triangles of \e mesh: a triangle is appended to a strip if
+ * it shares the last edge of the strip and has the same orientation as the strip at this place.
+ * Each strip is started at the first triangle not used yet, from the corner which gives the
+ * longest strip (greedy stripification).
+ * Triangles can only be joined if they share the vertices, so meshes which define the
+ * vertices for each triangle should be imported with aiProcess_JoinIdenticalVertices.
+ * \return the indices for SoIndexedTriangleStripSet, each strip terminated by -1.
+ */
+std::vector<int32_t> getTriangleStrips(const aiMesh *const mesh)
+{
+    const std::size_t numFaces(mesh->mNumFaces);
+
+    //All edges with the face they belong to, sorted by edge
+    ///The key of an edge is made of both vertex indices, the smaller one first
+    std::vector<std::pair<uint64_t, uint32_t> > edges;
+    edges.reserve(3 * numFaces);
+    for (std::size_t i(0); i < numFaces; ++i)
+    {
+        const unsigned int *const v(mesh->mFaces[i].mIndices);
+        for (std::size_t j(0); j < 3; ++j)
+        {
+            const uint64_t a(v[j]), b(v[(j + 1) % 3]);
+            edges.push_back(std::make_pair(a < b ? ((a << 32) | b) : ((b << 32) | a), i));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    std::vector<bool> used(numFaces, false);
+    //Faces taken by the strip which is currently being built
+    std::vector<std::size_t> taken(numFaces, 0);
+    std::size_t attempt(0);
+
+    std::vector<int32_t> strips;
+    strips.reserve(2 * numFaces);
+    std::vector<unsigned int> strip, bestStrip;
+    std::vector<uint32_t> stripFaces, bestStripFaces;
+    for (std::size_t i(0); i < numFaces; ++i)
+    {
+        if (used[i]) continue;
+        const unsigned int *const start(mesh->mFaces[i].mIndices);
+        bestStrip.clear();
+        for (std::size_t corner(0); corner < 3; ++corner)
+        {
+            ++attempt;
+            strip.assign(1, start[corner]);
+            strip.push_back(start[(corner + 1) % 3]);
+            strip.push_back(start[(corner + 2) % 3]);
+            stripFaces.assign(1, i);
+            taken[i] = attempt;
+
+            //Extend the strip over its last edge. Triangle k of a strip is
+            //(v[k], v[k+1], v[k+2]) for even k and (v[k+1], v[k], v[k+2]) for odd k.
+            bool extended(true);
+            while (extended)
+            {
+                extended = false;
+                const std::size_t n(strip.size());
+                const bool even((n % 2) == 0);
+                const unsigned int a(even ? strip[n - 2] : strip[n - 1]);
+                const unsigned int b(even ? strip[n - 1] : strip[n - 2]);
+                const uint64_t key(a < b ? ((uint64_t(a) << 32) | b) : ((uint64_t(b) << 32) | a));
+                std::vector<std::pair<uint64_t, uint32_t> >::const_iterator it(
+                    std::lower_bound(edges.begin(), edges.end(), std::make_pair(key, uint32_t(0))));
+                for (; (it != edges.end()) && (it->first == key); ++it)
+                {
+                    const uint32_t face(it->second);
+                    if (used[face] || (taken[face] == attempt)) continue;
+                    //The face continues the strip if it contains the edge (a, b) in this direction
+                    const unsigned int *const v(mesh->mFaces[face].mIndices);
+                    if ((v[0] == v[1]) || (v[1] == v[2]) || (v[0] == v[2])) continue;
+                    std::size_t j(0);
+                    while ((j < 3) && !((v[j] == a) && (v[(j + 1) % 3] == b))) ++j;
+                    if (j == 3) continue;
+
+                    strip.push_back(v[(j + 2) % 3]);
+                    stripFaces.push_back(face);
+                    taken[face] = attempt;
+                    extended = true;
+                    break;
+                }
+            }
+            if (strip.size() > bestStrip.size())
+            {
+                bestStrip.swap(strip);
+                bestStripFaces.swap(stripFaces);
+            }
+        }
+
+        for (std::size_t j(0); j < bestStripFaces.size(); ++j)
+        {
+            used[bestStripFaces[j]] = true;
+        }
+        strips.insert(strips.end(), bestStrip.begin(), bestStrip.end());
+        strips.push_back(-1);
+    }
+    return strips;
+}
+
+
+/**
+ * \param triangleFaceSet convert triangle meshes to SoIndexedFaceSet instead of SoIndexedTriangleStripSet
+ * \param strips the triangle strips of \e mesh (see getTriangleStrips()), used if \e triangleFaceSet is false
+ */
+SoIndexedShape *getShape(const aiMesh *const mesh, const bool triangleFaceSet, const std::vector<int32_t>& strips)
 {
     if (!mesh->HasPositions() || !mesh->HasFaces()) return NULL; //Mesh is empty
 
@@ -374,7 +625,8 @@ SoIndexedShape *getShape(const aiMesh *const mesh)
         numIndices = 2;
         break;
     case aiPrimitiveType_TRIANGLE:
-        shape = new SoIndexedTriangleStripSet;
+        if (triangleFaceSet) shape = new SoIndexedFaceSet;
+        else shape = new SoIndexedTriangleStripSet;
         numIndices = 3;
         break;
     default:
@@ -392,26 +644,12 @@ SoIndexedShape *getShape(const aiMesh *const mesh)
     shape->vertexProperty.setValue(vertexProperty);
 
     //Set vertices
-    float vertices[mesh->mNumVertices][3];
-    for (std::size_t i(0); i < mesh->mNumVertices; ++i)
-    {
-        vertices[i][0] = mesh->mVertices[i].x;
-        vertices[i][1] = mesh->mVertices[i].y;
-        vertices[i][2] = mesh->mVertices[i].z;
-    }
-    vertexProperty->vertex.setValues(0, mesh->mNumVertices, vertices);
+    setVec3Values(vertexProperty->vertex, mesh->mVertices, mesh->mNumVertices);
 
     if (mesh->HasNormals())
     {
         //Set normals
-        float normals[mesh->mNumVertices][3];
-        for (std::size_t i(0); i < mesh->mNumVertices; ++i)
-        {
-            normals[i][0] = mesh->mNormals[i].x;
-            normals[i][1] = mesh->mNormals[i].y;
-            normals[i][2] = mesh->mNormals[i].z;
-        }
-        vertexProperty->normal.setValues(0, mesh->mNumVertices, normals);
+        setVec3Values(vertexProperty->normal, mesh->mNormals, mesh->mNumVertices);
     }
 
     if (mesh->GetNumColorChannels() > 0)
@@ -448,27 +686,21 @@ SoIndexedShape *getShape(const aiMesh *const mesh)
         //Set texture coordinates
         if (mesh->mNumUVComponents[0] == 2)
         {
-            float texCoords[mesh->mNumVertices][2];
+            vertexProperty->texCoord.setNum(mesh->mNumVertices);
+            SbVec2f *texCoords(vertexProperty->texCoord.startEditing());
             for (std::size_t i(0); i < mesh->mNumVertices; ++i)
             {
-                texCoords[i][0] = mesh->mTextureCoords[0][i].x;
-                texCoords[i][1] = mesh->mTextureCoords[0][i].y;
+                texCoords[i] = SbVec2f(mesh->mTextureCoords[0][i].x,
+                                       mesh->mTextureCoords[0][i].y);
             }
-            vertexProperty->texCoord.setValues(0, mesh->mNumVertices, texCoords);
+            vertexProperty->texCoord.finishEditing();
         }
         else if (mesh->mNumUVComponents[0] == 3)
         {
             std::cout << "Setting texture coordinates of 3 components "
                       << "but all the loaded textures will be of 2 components." << std::endl;
 
-            float texCoords3[mesh->mNumVertices][3];
-            for (std::size_t i(0); i < mesh->mNumVertices; ++i)
-            {
-                texCoords3[i][0] = mesh->mTextureCoords[0][i].x;
-                texCoords3[i][1] = mesh->mTextureCoords[0][i].y;
-                texCoords3[i][2] = mesh->mTextureCoords[0][i].z;
-            }
-            vertexProperty->texCoord3.setValues(0, mesh->mNumVertices, texCoords3);
+            setVec3Values(vertexProperty->texCoord3, mesh->mTextureCoords[0], mesh->mNumVertices);
         }
         else
         {
@@ -478,39 +710,154 @@ SoIndexedShape *getShape(const aiMesh *const mesh)
     }
 
     //Set faces
-    int indices[mesh->mNumFaces * (numIndices + 1)];
+    if ((mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE) && !triangleFaceSet)
+    {
+        shape->coordIndex.setValues(0, strips.size(), &strips[0]);
+        return shape;
+    }
+
+    shape->coordIndex.setNum(mesh->mNumFaces * (numIndices + 1));
+    int32_t *indices(shape->coordIndex.startEditing());
     for (std::size_t i(0); i < mesh->mNumFaces; ++i)
     {
         for (std::size_t j(0); j < numIndices; ++j)
         {
-            indices[i * (numIndices + 1) + j] = mesh->mFaces[i].mIndices[j];
+            *indices++ = mesh->mFaces[i].mIndices[j];
         }
-        indices[i * (numIndices + 1) + numIndices] = -1;
+        *indices++ = -1;
     }
-    shape->coordIndex.setValues(0, mesh->mNumFaces * (numIndices + 1), indices);
+    shape->coordIndex.finishEditing();
 
     return shape;
 }
 
 
-SoSeparator *getMesh(const aiMesh *const mesh, const aiMaterial *const material,
-                     const std::string& sceneDir, SoSeparator *meshSep = NULL, const SoMaterial * materialOverride = NULL)
+/**
+ * Returns true if triangle meshes are converted to triangle strips with \e options
+ */
+bool useTriangleStrips(const aiMesh *const mesh, const urdf2inventor::MeshConversionOptions& options)
 {
-    SoIndexedShape *shape(getShape(mesh));
+    return (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE) &&
+           (options.triangleShape != urdf2inventor::MeshConversionOptions::FACE_SET);
+}
+
+
+/**
+ * Builds the triangle strips of \e mesh and simplifies its lower levels of detail, for the
+ * ratios of MeshConversionOptions::lodRatios. Each level is simplified from the previous one, so
+ * that only the first level has to be simplified from the full mesh.
+ */
+void prepareMesh(const aiMesh *const mesh, const urdf2inventor::MeshConversionOptions& options,
+                 PreparedMesh& prepared)
+{
+    if (useTriangleStrips(mesh, options)) prepared.strips = getTriangleStrips(mesh);
+    if ((mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE) || options.lodRatios.empty()) return;
+
+    const aiMesh *previous(mesh);
+    for (std::size_t i(0); i < options.lodRatios.size(); ++i)
+    {
+        const unsigned int targetFaces(options.lodRatios[i] * mesh->mNumFaces);
+        baselib_binding::shared_ptr<aiMesh>::type level(urdf2inventor::simplifyMesh(previous, targetFaces));
+        if (!level) continue;
+        //The simplification stops early if no more edges can be collapsed,
+        //a level is only worth adding if it has noticeably fewer faces
+        if (level->mNumFaces > 0.9 * previous->mNumFaces) continue;
+        prepared.levels.push_back(level);
+        prepared.levelStrips.push_back(useTriangleStrips(level.get(), options) ?
+                                       getTriangleStrips(level.get()) : std::vector<int32_t>());
+        prepared.levelRatios.push_back(i);
+        previous = level.get();
+    }
+}
+
+
+void prepareScene(const aiScene *const scene, const urdf2inventor::MeshConversionOptions& options,
+                  PreparedScene& prepared)
+{
+    prepared.assign(scene->mNumMeshes, PreparedMesh());
+    for (std::size_t i(0); i < scene->mNumMeshes; ++i)
+    {
+        prepareMesh(scene->mMeshes[i], options, prepared[i]);
+    }
+}
+
+
+/**
+ * Builds the shapes of the lower levels of detail of the triangle \e mesh, which have been
+ * simplified in prepareMesh().
+ * \param shape the shape of the full mesh
+ * \return an SoLOD with \e shape as the first child and the simplified shapes as the
+ *      following children, or \e shape if no lower level of detail could be built.
+ */
+SoNode *getLevelsOfDetail(const aiMesh *const mesh, SoIndexedShape *const shape, const PreparedMesh& prepared,
+                          const urdf2inventor::MeshConversionOptions& options)
+{
+    std::vector<SoIndexedShape*> levels;
+    std::vector<float> ranges;
+    for (std::size_t i(0); i < prepared.levels.size(); ++i)
+    {
+        SoIndexedShape *levelShape(getShape(prepared.levels[i].get(),
+                                            options.triangleShape == urdf2inventor::MeshConversionOptions::FACE_SET,
+                                            prepared.levelStrips[i]));
+        if (levelShape)
+        {
+            std::stringstream levelName;
+            levelName << mesh->mName.C_Str() << "_lod" << (levels.size() + 1);
+            levelShape->setName(getName(levelName.str()));
+            levels.push_back(levelShape);
+            ranges.push_back(options.getLodRange(prepared.levelRatios[i]));
+        }
+    }
+
+    if (levels.empty()) return shape;
+
+    std::cout << "Built " << levels.size() << " levels of detail of mesh " << mesh->mName.C_Str()
+              << " with " << mesh->mNumFaces << " faces" << std::endl;
+
+    SoLOD *lod(new SoLOD);
+    //Switch the levels by the distance to the center of the mesh
+    aiVector3D minPoint(mesh->mVertices[0]), maxPoint(mesh->mVertices[0]);
+    for (std::size_t i(1); i < mesh->mNumVertices; ++i)
+    {
+        minPoint.x = std::min(minPoint.x, mesh->mVertices[i].x);
+        minPoint.y = std::min(minPoint.y, mesh->mVertices[i].y);
+        minPoint.z = std::min(minPoint.z, mesh->mVertices[i].z);
+        maxPoint.x = std::max(maxPoint.x, mesh->mVertices[i].x);
+        maxPoint.y = std::max(maxPoint.y, mesh->mVertices[i].y);
+        maxPoint.z = std::max(maxPoint.z, mesh->mVertices[i].z);
+    }
+    lod->center.setValue((minPoint.x + maxPoint.x) / 2, (minPoint.y + maxPoint.y) / 2, (minPoint.z + maxPoint.z) / 2);
+    lod->range.setValues(0, ranges.size(), &ranges[0]);
+    lod->addChild(shape);
+    for (std::size_t i(0); i < levels.size(); ++i)
+    {
+        lod->addChild(levels[i]);
+    }
+    return lod;
+}
+
+
+SoSeparator *getMesh(const aiMesh *const mesh, const PreparedMesh& prepared, const aiMaterial *const material,
+                     const aiTexture *const *const textures, const unsigned int numTextures,
+                     const std::string& sceneDir, SoSeparator *meshSep = NULL, const SoMaterial * materialOverride = NULL,
+                     const urdf2inventor::MeshConversionOptions& options = urdf2inventor::MeshConversionOptions())
+{
+    SoIndexedShape *shape(getShape(mesh, options.triangleShape == urdf2inventor::MeshConversionOptions::FACE_SET,
+                                   prepared.strips));
     if (shape)
     {
         if (!meshSep) meshSep = new SoSeparator;
 
         //Add texture
-        SoTexture *texture(getTexture(material, sceneDir));
+        SoTexture *texture(getTexture(material, textures, numTextures, sceneDir, options));
         if (texture) meshSep->addChild(texture);
 
         //Add material
         if (!materialOverride) meshSep->addChild(getMaterial(material));
         else meshSep->addChild(cloneMaterial(*materialOverride));
 
-        //Add shape
-        meshSep->addChild(shape);
+        //Add shape, with its levels of detail if required
+        meshSep->addChild(getLevelsOfDetail(mesh, shape, prepared, options));
 
         return meshSep;
     }
@@ -536,8 +883,8 @@ bool hasMesh(const aiNode *node)
  */
 void addNode(SoSeparator *const parent, const aiNode *const node,
              const aiMaterial *const *const materials, const aiMesh *const *const meshes,
-             const aiTexture *const *const textures, const std::string& sceneDir,
-             const SoMaterial * materialOverride)
+             const PreparedScene& prepared, const aiTexture *const *const textures, const unsigned int numTextures, const std::string& sceneDir,
+             const SoMaterial * materialOverride, const urdf2inventor::MeshConversionOptions& options)
 {
     if (hasMesh(node))
     {
@@ -561,20 +908,20 @@ void addNode(SoSeparator *const parent, const aiNode *const node,
             //Add meshes
             if (node->mNumMeshes == 1 && node->mNumChildren == 0)
             {
-                getMesh(meshes[node->mMeshes[0]],
+                getMesh(meshes[node->mMeshes[0]], prepared[node->mMeshes[0]],
                         materials[meshes[node->mMeshes[0]]->mMaterialIndex],
-                        sceneDir, nodeSep,
-                        materialOverride);
+                        textures, numTextures, sceneDir, nodeSep,
+                        materialOverride, options);
             }
             else
             {
                 for (std::size_t i(0); i < node->mNumMeshes; ++i)
                 {
-                    SoNode *child(getMesh(meshes[node->mMeshes[i]],
+                    SoNode *child(getMesh(meshes[node->mMeshes[i]], prepared[node->mMeshes[i]],
                                           //useMaterial,
                                           materials[meshes[node->mMeshes[i]]->mMaterialIndex],
-                                          sceneDir, NULL,
-                                          materialOverride));
+                                          textures, numTextures, sceneDir, NULL,
+                                          materialOverride, options));
                     //delete useMaterial; // delete because this was a temporary copy
                     if (child) nodeSep->addChild(child);
                 }
@@ -584,7 +931,8 @@ void addNode(SoSeparator *const parent, const aiNode *const node,
         //Add children nodes
         for (std::size_t i(0); i < node->mNumChildren; ++i)
         {
-            addNode(nodeSep, node->mChildren[i], materials, meshes, textures, sceneDir, materialOverride);
+            addNode(nodeSep, node->mChildren[i], materials, meshes, prepared, textures, numTextures, sceneDir,
+                    materialOverride, options);
         }
     }
 }
@@ -593,19 +941,22 @@ void addNode(SoSeparator *const parent, const aiNode *const node,
  * \param materialOverride can be used to override ALL NODES material properties to given values.
  */
 SoSeparator *Assimp2Inventor(const aiScene *const scene, const std::string& sceneDir,
-                             const SoMaterial * materialOverride)
+                             const SoMaterial * materialOverride,
+                             const urdf2inventor::MeshConversionOptions& options,
+                             const PreparedScene * prepared)
 {
+    PreparedScene preparedHere;
+    if (!prepared)
+    {
+        prepareScene(scene, options, preparedHere);
+        prepared = &preparedHere;
+    }
     SoSeparator *root(new SoSeparator);
     /*    ROS_INFO_STREAM("Imported a scene with " << scene->mNumTextures << " embedded textures, "
                   << scene->mNumMaterials << " materials and "
                   << scene->mNumMeshes << " meshes.");*/
-    if (scene->mNumTextures > 0)
-    {
-        std::cout << "Found a scene with embedded textures. They will be ignored." << std::endl;
-        ///I don't know how they will be referenced inside the scene
-    }
     addNode(root, scene->mRootNode, scene->mMaterials,
-            scene->mMeshes, scene->mTextures, sceneDir, materialOverride);
+            scene->mMeshes, *prepared, scene->mTextures, scene->mNumTextures, sceneDir, materialOverride, options);
     return root;
 }
 
@@ -624,7 +975,64 @@ std::vector<std::string> tokenize(const std::string &str, const std::string &tok
 }
 
 
-std::vector<std::string> assimpImportedExtensions()
+/**
+ * Importers which are currently not in use, see getPooledImporter().
+ */
+class ImporterPool
+{
+public:
+    ImporterPool() {}
+    ~ImporterPool()
+    {
+        for (std::vector<Assimp::Importer*>::iterator it = importers.begin(); it != importers.end(); ++it)
+            delete *it;
+    }
+
+    Assimp::Importer * acquire()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (importers.empty()) return new Assimp::Importer();
+        Assimp::Importer * importer = importers.back();
+        importers.pop_back();
+        return importer;
+    }
+
+    void release(Assimp::Importer * importer)
+    {
+        importer->FreeScene();
+        std::lock_guard<std::mutex> lock(mutex);
+        importers.push_back(importer);
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<Assimp::Importer*> importers;
+};
+
+ImporterPool& getImporterPool()
+{
+    static ImporterPool pool;
+    return pool;
+}
+
+/**
+ * Deleter of the pointers returned by getPooledImporter()
+ */
+struct ReleasePooledImporter
+{
+    void operator()(Assimp::Importer * importer) const
+    {
+        getImporterPool().release(importer);
+    }
+};
+
+baselib_binding::shared_ptr<Assimp::Importer>::type getPooledImporter()
+{
+    return baselib_binding::shared_ptr<Assimp::Importer>::type(getImporterPool().acquire(), ReleasePooledImporter());
+}
+
+
+std::vector<std::string> readImportedExtensions()
 {
     aiString tmp;
     Assimp::Importer importer;
@@ -635,7 +1043,14 @@ std::vector<std::string> assimpImportedExtensions()
 }
 
 
-std::vector<std::pair<std::string, std::vector<std::string> > > assimpImportedFormats()
+const std::vector<std::string>& assimpImportedExtensions()
+{
+    static const std::vector<std::string> extensions = readImportedExtensions();
+    return extensions;
+}
+
+
+std::vector<std::pair<std::string, std::vector<std::string> > > readImportedFormats()
 {
     std::vector<std::pair<std::string, std::vector<std::string> > > importedFormats;
     const aiImporterDesc *importerDesc;
@@ -685,3 +1100,9 @@ std::vector<std::pair<std::string, std::vector<std::string> > > assimpImportedFo
     return importedFormats;
 }
 
+
+const std::vector<std::pair<std::string, std::vector<std::string> > >& assimpImportedFormats()
+{
+    static const std::vector<std::pair<std::string, std::vector<std::string> > > formats = readImportedFormats();
+    return formats;
+}
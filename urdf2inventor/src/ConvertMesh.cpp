@@ -36,6 +36,7 @@
 #include <urdf2inventor/IVHelpers.h>
 #include <urdf2inventor/ConvertMesh.h>
 #include <urdf2inventor/MeshConvertRecursionParams.h>
+#include <urdf2inventor/MeshCache.h>
 
 #include <urdf2inventor/AssimpImport.h>
 
@@ -52,6 +53,15 @@
 #include <assimp/Importer.hpp>
 #include <assimp/importerdesc.h>
 #include <assimp/postprocess.h>
+#include <assimp/config.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <map>
 
 
 using urdf_traverser::UrdfTraverser;
@@ -68,28 +78,207 @@ typedef urdf_traverser::CylinderPtr CylinderPtr;
 typedef urdf_traverser::BoxPtr BoxPtr;
 //typedef urdf_traverser::Ptr Ptr;
 
+typedef baselib_binding::shared_ptr<Assimp::Importer>::type ImporterPtr;
+
+using urdf2inventor::MeshCachePtr;
+using urdf2inventor::MeshConversionOptions;
+
+/**
+ * A mesh which has been imported already, and prepared for the conversion with prepareScene().
+ * The scene is owned by the importer, which is taken from the pool of
+ * importers (see getPooledImporter()) and returns to it when released.
+ */
+struct ImportedMesh
+{
+    ImporterPtr importer;
+    PreparedScene prepared;
+};
+
+// Meshes which have been imported already, indexed by the absolute file name.
+typedef std::map<std::string, ImportedMesh> ImportedMeshes;
+
+// Coin is not thread-safe (unless it has been built with thread safety), so the
+// parallel mesh conversion does the Assimp imports, triangle strips and simplification
+// concurrently and only holds this mutex while it builds and writes the Coin scene graphs.
+static std::mutex coinMutex;
+
+// Meshes which have been imported by the current thread before the conversion of a link
+// in the parallel mesh conversion, or NULL if the meshes are to be imported in convertMeshFile().
+static thread_local ImportedMeshes * threadImportedMeshes = NULL;
+
+/**
+ * Returns the post-processing steps of Assimp to import the mesh files with.
+ */
+unsigned int getImportFlags(const MeshConversionOptions& options)
+{
+    unsigned int flags = aiProcess_OptimizeGraph | aiProcess_FindInvalidData;
+    switch (options.postProcessing)
+    {
+    case MeshConversionOptions::POSTPROCESS_FAST:
+        flags |= aiProcess_Triangulate | aiProcess_SortByPType;
+        break;
+    case MeshConversionOptions::POSTPROCESS_RENDER_OPTIMIZED:
+        flags |= aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_JoinIdenticalVertices |
+                 aiProcess_FindDegenerates | aiProcess_OptimizeMeshes | aiProcess_ImproveCacheLocality;
+        break;
+    case MeshConversionOptions::POSTPROCESS_COLLISION_MINIMAL:
+        flags |= aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_JoinIdenticalVertices |
+                 aiProcess_FindDegenerates | aiProcess_OptimizeMeshes | aiProcess_RemoveComponent |
+                 aiProcess_RemoveRedundantMaterials;
+        break;
+    default:
+        break;
+    }
+    if (options.joinIdenticalVertices) flags |= aiProcess_JoinIdenticalVertices;
+    return flags;
+}
+
+/**
+ * Counts the meshes, vertices and faces of the \e scene
+ */
+void getSceneSize(const aiScene * scene, unsigned int& numMeshes, unsigned int& numVertices, unsigned int& numFaces)
+{
+    numMeshes = scene->mNumMeshes;
+    numVertices = 0;
+    numFaces = 0;
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+    {
+        numVertices += scene->mMeshes[i]->mNumVertices;
+        numFaces += scene->mMeshes[i]->mNumFaces;
+    }
+}
+
+/**
+ * Imports the mesh file with Assimp. The scene is owned by \e importer.
+ * The time needed for the import and for the post-processing, and the size of
+ * the scene before and after post-processing are reported.
+ */
+const aiScene * importMeshFile(Assimp::Importer& importer, const std::string& filename,
+                               const MeshConversionOptions& options)
+{
+    // importers are re-used, so the configuration has to be set for every import
+    const bool collision = (options.postProcessing == MeshConversionOptions::POSTPROCESS_COLLISION_MINIMAL);
+    importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, collision ?
+                                (aiComponent_NORMALS | aiComponent_TANGENTS_AND_BITANGENTS | aiComponent_COLORS |
+                                 aiComponent_TEXCOORDS | aiComponent_TEXTURES) : 0);
+    importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, collision ? (aiPrimitiveType_POINT | aiPrimitiveType_LINE) : 0);
+    // remove degenerate triangles instead of converting them to lines and points
+    importer.SetPropertyInteger(AI_CONFIG_PP_FD_REMOVE, 1);
+
+    ros::WallTime start = ros::WallTime::now();
+    const aiScene * scene = importer.ReadFile(filename, 0);
+    if (!scene || !scene->mRootNode) return NULL;
+    double importTime = (ros::WallTime::now() - start).toSec();
+
+    unsigned int numMeshes, numVertices, numFaces;
+    getSceneSize(scene, numMeshes, numVertices, numFaces);
+
+    start = ros::WallTime::now();
+    scene = importer.ApplyPostProcessing(getImportFlags(options));
+    if (!scene || !scene->mRootNode) return NULL;
+    double postProcessTime = (ros::WallTime::now() - start).toSec();
+
+    unsigned int numMeshesAfter, numVerticesAfter, numFacesAfter;
+    getSceneSize(scene, numMeshesAfter, numVerticesAfter, numFacesAfter);
+    ROS_INFO("Imported %s in %.1f ms, post-processing %.1f ms: %u meshes, %u vertices, %u faces -> "
+             "%u meshes, %u vertices, %u faces", filename.c_str(), importTime * 1000, postProcessTime * 1000,
+             numMeshes, numVertices, numFaces, numMeshesAfter, numVerticesAfter, numFacesAfter);
+    return scene;
+}
+
+/**
+ * Returns a string describing the settings of convertMeshFile(). All settings
+ * which change the result of the conversion have to be part of it.
+ */
+std::string getMeshSettings(double scale_factor, const MeshConversionOptions& options,
+                            bool setExplicitMaterial, double r, double g, double b, double a)
+{
+    char settings[256];
+    if (setExplicitMaterial)
+        snprintf(settings, sizeof(settings), "v1;scale=%.17g;flags=%x;shape=%i;material=%.9g,%.9g,%.9g,%.9g",
+                 scale_factor, getImportFlags(options), options.triangleShape, r, g, b, a);
+    else
+        snprintf(settings, sizeof(settings), "v1;scale=%.17g;flags=%x;shape=%i;material=none",
+                 scale_factor, getImportFlags(options), options.triangleShape);
+    std::string result(settings);
+    for (unsigned int i = 0; i < options.lodRatios.size(); ++i)
+    {
+        snprintf(settings, sizeof(settings), ";lod=%.9g@%.9g", options.lodRatios[i], options.getLodRange(i));
+        result += settings;
+    }
+    // meshes with embedded textures reference the files extracted to this directory
+    if (!options.embeddedTextureDir.empty()) result += ";embedded=" + options.embeddedTextureDir;
+    return result;
+}
+
+/**
+ * Gets the key of the conversion of mesh file \e filename in the \e meshCache.
+ * Texture files referenced by the mesh are resolved relative to the directory of the mesh file,
+ * and the conversion references them with absolute paths. A file with the same contents in another
+ * directory may therefore lead to another conversion, so the directory is part of the key.
+ * \return false if the key could not be computed (the mesh file can't be read)
+ */
+bool getMeshCacheKey(urdf2inventor::MeshCache& meshCache, const std::string& filename, double scale_factor,
+                     const MeshConversionOptions& options,
+                     bool setExplicitMaterial, double r, double g, double b, double a, std::string& key)
+{
+    std::string settings = getMeshSettings(scale_factor, options, setExplicitMaterial, r, g, b, a);
+    settings += ";dir=" + boost::filesystem::path(filename).parent_path().string();
+    return meshCache.getKey(filename, settings, key);
+}
+
 /**
  * Converts the mesh in this file to the inventor format.
+ * \param meshCache if not NULL, the conversion is taken from this cache if it has been converted
+ *      already with the same settings, and otherwise added to it.
  */
-SoNode * convertMeshFile(const std::string& filename, double scale_factor, bool setExplicitMaterial = false, double r = 0.5, double g = 0.5, double b = 0.5, double a = 1)
+SoNode * convertMeshFile(const std::string& filename, double scale_factor,
+                         const MeshConversionOptions& options, const MeshCachePtr& meshCache,
+                         bool setExplicitMaterial = false, double r = 0.5, double g = 0.5, double b = 0.5, double a = 1)
 {
+    std::string cacheKey;
+    if (meshCache && getMeshCacheKey(*meshCache, filename, scale_factor, options,
+                                     setExplicitMaterial, r, g, b, a, cacheKey))
+    {
+        std::string ivContent;
+        if (meshCache->get(cacheKey, ivContent))
+        {
+            SoNode * cached = urdf2inventor::readInventorFileString(ivContent);
+            if (cached)
+            {
+                ROS_INFO_STREAM("Using cached conversion " << cacheKey << " of mesh " << filename);
+                return cached;
+            }
+            ROS_WARN_STREAM("Could not read cached conversion " << cacheKey << " of mesh " << filename
+                            << ", converting it again.");
+        }
+    }
+
 //    ROS_INFO("Reading file...");
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(filename, aiProcess_OptimizeGraph |
-                           aiProcess_FindInvalidData);
-    /*aiProcess_Triangulate |
-    aiProcess_OptimizeMeshes |
-    /aiProcess_CalcTangentSpace             |
-    aiProcess_Triangulate                        |
-    aiProcess_JoinIdenticalVertices    |
-    aiProcess_SortByPType);*/
+    const aiScene* scene = NULL;
+    ImporterPtr importer;
+    const PreparedScene * prepared = NULL;
+    ImportedMeshes::iterator imported;
+    if (threadImportedMeshes && ((imported = threadImportedMeshes->find(filename)) != threadImportedMeshes->end()))
+    {
+        importer = imported->second.importer;
+        scene = importer->GetScene();
+        prepared = &imported->second.prepared;
+    }
+    else
+    {
+        importer = getPooledImporter();
+        scene = importMeshFile(*importer, filename, options);
+    }
     if (!scene || !scene->mRootNode)
     {
         ROS_ERROR_STREAM("Could not import file " << filename);
         return NULL;
     }
 
-    // scale the meshes if required
+    // scale the meshes if required. The original transform is restored after the
+    // conversion, as an imported scene may be used for several visuals.
+    const aiMatrix4x4 rootTransform = scene->mRootNode->mTransformation;
     if (fabs(scale_factor - 1.0) > 1e-06)
     {
         ROS_INFO_STREAM("Scaling the mesh " << filename << " with factor " << scale_factor);
@@ -110,15 +299,91 @@ SoNode * convertMeshFile(const std::string& filename, double scale_factor, bool
         overrideMaterial->transparency.setValue(1.0 - a);
     }
 //    ROS_INFO("Converting to inventor...");
-    SoSeparator * ivScene = Assimp2Inventor(scene, sceneDir, overrideMaterial);
+    SoSeparator * ivScene = Assimp2Inventor(scene, sceneDir, overrideMaterial, options, prepared);
+    scene->mRootNode->mTransformation = rootTransform;
     if (!ivScene)
     {
         ROS_ERROR("Could not convert scene");
         return NULL;
     }
+
+    if (!cacheKey.empty())
+    {
+        // writing applies an action, which would delete the node while its reference count is 0
+        ivScene->ref();
+        std::string ivContent;
+        if (urdf2inventor::writeInventorFileString(ivScene, ivContent))
+            meshCache->add(cacheKey, ivContent);
+        else
+            ROS_WARN_STREAM("Could not add the conversion of mesh " << filename << " to the cache");
+        ivScene->unrefNoDelete();
+    }
     return ivScene;
 }
 
+/**
+ * Material used for the collision geometries, which don't have materials in URDF.
+ */
+MaterialPtr getCollisionMaterial()
+{
+    // XXX TODO allow to set a material for collision shapes, which inherently don't have materials.
+    // Because collision geometries don't match to visual geometries
+    // (could be different numbers!), we can't infer from visual.
+    MaterialPtr mat(new urdf::Material());
+    mat->color.r=0.1;
+    mat->color.g=0.1;
+    mat->color.b=0.5;
+    mat->color.a=1;
+    return mat;
+}
+
+/**
+ * Imports all mesh files of the visuals (or collision geometries if \e useVisuals is false)
+ * of the link into \e meshes, and prepares them for the conversion (see prepareScene()).
+ * Files which can't be imported are left out, the error is reported when they are converted in convertMeshFile().
+ * Meshes of which the conversion is in \e meshCache already are not imported.
+ */
+void importLinkMeshes(const urdf_traverser::LinkPtr& link, const bool useVisuals,
+                      const double scale_factor, const MeshConversionOptions& options,
+                      const MeshCachePtr& meshCache, ImportedMeshes& meshes)
+{
+    std::vector<std::pair<GeometryPtr, MaterialPtr> > geometries;
+    if (useVisuals)
+    {
+        for (unsigned int i = 0; i < link->visual_array.size(); ++i)
+            geometries.push_back(std::make_pair(link->visual_array[i]->geometry, link->visual_array[i]->material));
+    }
+    else
+    {
+        MaterialPtr collisionMaterial = getCollisionMaterial();
+        for (unsigned int i = 0; i < link->collision_array.size(); ++i)
+            geometries.push_back(std::make_pair(link->collision_array[i]->geometry, collisionMaterial));
+    }
+
+    for (std::vector<std::pair<GeometryPtr, MaterialPtr> >::iterator it = geometries.begin(); it != geometries.end(); ++it)
+    {
+        MeshPtr mesh = shr_lib::dynamic_pointer_cast<urdf::Mesh>(it->first);
+        if (!mesh) continue;
+        std::string meshFilename = urdf_traverser::helpers::packagePathToAbsolute(mesh->filename);
+        if (meshFilename.empty() || (meshes.find(meshFilename) != meshes.end())) continue;
+
+        const MaterialPtr& mat = it->second;
+        std::string cacheKey;
+        if (meshCache && getMeshCacheKey(*meshCache, meshFilename, scale_factor, options, mat != NULL,
+                                         mat ? mat->color.r : 0.5, mat ? mat->color.g : 0.5,
+                                         mat ? mat->color.b : 0.5, mat ? mat->color.a : 1.0, cacheKey)
+                && meshCache->has(cacheKey))
+            continue;
+
+        ImporterPtr importer = getPooledImporter();
+        const aiScene * scene = importMeshFile(*importer, meshFilename, options);
+        if (!scene || !scene->mRootNode) continue;
+        ImportedMesh& imported = meshes[meshFilename];
+        imported.importer = importer;
+        prepareScene(scene, options, imported.prepared);
+    }
+}
+
 
 /**
  * Code from https://grey.colorado.edu/coin3d/classSoTexture2.html
@@ -223,7 +488,10 @@ bool addGeometry(SoSeparator * addToNode, const std::string& linkName, double sc
                    const MaterialPtr& mat,
                    const urdf_traverser::EigenTransform& geometryTransform,  // transform to the geometry
                    const urdf_traverser::EigenTransform& addMeshTransform, // transform to add only to mesh shapes
-                   const bool scaleUrdfTransforms)
+                   const bool scaleUrdfTransforms,
+                   const MeshConversionOptions& options,
+                   const MeshCachePtr& meshCache,
+                   urdf2inventor::SharedMeshNodes * sharedMeshes)
 {
     
         urdf_traverser::EigenTransform geomTransform = geometryTransform;
@@ -257,18 +525,37 @@ bool addGeometry(SoSeparator * addToNode, const std::string& linkName, double sc
                 b = mat->color.b;
                 a = mat->color.a;
             }
-            SoNode * somesh = convertMeshFile(meshFilename, scale_factor, mat != NULL, r, g, b, a);
+            std::stringstream str;
+            str << "_visual_" << geomNum << "_" << linkName;
+
+            // re-use the node if this mesh has been converted with the same settings before
+            std::string sharedKey;
+            SoNode * somesh = NULL;
+            if (sharedMeshes)
+            {
+                sharedKey = meshFilename + ";" + getMeshSettings(scale_factor, options, mat != NULL, r, g, b, a);
+                urdf2inventor::SharedMeshNodes::iterator shared = sharedMeshes->find(sharedKey);
+                if (shared != sharedMeshes->end()) somesh = shared->second;
+            }
+            if (somesh)
+            {
+                ROS_INFO_STREAM("Using shared instance " << somesh->getName().getString() << " of mesh " << meshFilename);
+                // the shared node keeps the name of its first use, so give the name to the transform node instead
+                urdf2inventor::addSubNode(somesh, addToNode, meshGeomTransform, str.str().c_str());
+                break;
+            }
+
+            somesh = convertMeshFile(meshFilename, scale_factor, options, meshCache, mat != NULL, r, g, b, a);
             // ROS_INFO("Converted.");
             if (!somesh)
             {
                 ROS_ERROR("Mesh could not be read");
                 return false;
             }
-            std::stringstream str;
-            str << "_visual_" << geomNum << "_" << linkName;
             // ROS_INFO_STREAM("Visual name "<<str.str());
             somesh->setName(str.str().c_str());
             urdf2inventor::addSubNode(somesh, addToNode, meshGeomTransform);
+            if (sharedMeshes) (*sharedMeshes)[sharedKey] = somesh;
             break;
         }
         case urdf::Geometry::SPHERE:
@@ -342,7 +629,10 @@ bool addGeometry(SoSeparator * addToNode, const std::string& linkName, double sc
 SoNode * urdf2inventor::getAllGeometry(const urdf_traverser::LinkPtr link, double scale_factor,
                                       const urdf_traverser::EigenTransform& addVisualTransform,
                                       const bool useVisuals,
-                                      const bool scaleUrdfTransforms)
+                                      const bool scaleUrdfTransforms,
+                                      const MeshConversionOptions& options,
+                                      const MeshCachePtr& meshCache,
+                                      SharedMeshNodes * sharedMeshes)
 {
     SoNodeKit::init();
     SoSeparator * allVisuals = new SoSeparator();
@@ -366,7 +656,7 @@ SoNode * urdf2inventor::getAllGeometry(const urdf_traverser::LinkPtr link, doubl
             // ROS_INFO_STREAM("Visual "<<i<<" of link "<<link->name<<" transform: "<<visual->origin);
 
             if (!addGeometry(allVisuals, linkName, scale_factor,
-                       geom, i, mat, vTransform, addVisualTransform, scaleUrdfTransforms))
+                       geom, i, mat, vTransform, addVisualTransform, scaleUrdfTransforms, options, meshCache, sharedMeshes))
             {
                 ROS_ERROR_STREAM("Could not add geometry of link "<<link->name);
                 return NULL;
@@ -382,20 +672,13 @@ SoNode * urdf2inventor::getAllGeometry(const urdf_traverser::LinkPtr link, doubl
         {
             CollisionPtr coll = (*cit);
             GeometryPtr geom = coll->geometry;
-            // XXX TODO allow to set a material for collision shapes, which inherently don't have materials.
-            // Because collision geometries don't match to visual geometries
-            // (could be different numbers!), we can't infer from visual.
-            MaterialPtr mat(new urdf::Material());
-            mat->color.r=0.1;
-            mat->color.g=0.1;
-            mat->color.b=0.5;
-            mat->color.a=1;
+            MaterialPtr mat = getCollisionMaterial();
 
             urdf_traverser::EigenTransform cTransform = urdf_traverser::getTransform(coll->origin);
             // ROS_INFO_STREAM("Collision geometry "<<i<<" of link "<<link->name<<" transform: "<<coll->origin);
 
             if (!addGeometry(allVisuals, linkName, scale_factor,
-                       geom, i, mat, cTransform, addVisualTransform, scaleUrdfTransforms))
+                       geom, i, mat, cTransform, addVisualTransform, scaleUrdfTransforms, options, meshCache, sharedMeshes))
             {
                 ROS_ERROR_STREAM("Could not add geometry of link "<<link->name);
                 return NULL;
@@ -418,19 +701,24 @@ SoNode * urdf2inventor::getAllGeometry(const urdf_traverser::LinkPtr link, doubl
  * IV format and writes it to \e resultIV (after scaling meshes by \e scale_factor,
  * and optionally also the transforms if \e scaleUrdfTransforms is true).
  * It also returns all \e textureFiles (absolute paths to files) in use
- * by the link.
+ * by the link. Converted meshes are taken from and added to \e meshCache, if it is not NULL.
  */
 bool convertMeshToIVString(urdf_traverser::LinkPtr& link,
                            const float scale_factor,
                            const urdf_traverser::EigenTransform& addVisualTransform,
                            const bool useVisuals,
                            const bool scaleUrdfTransforms,
+                           const MeshConversionOptions& options,
+                           const MeshCachePtr& meshCache,
                            std::string& resultIV,
                            std::set<std::string>& textureFiles)
 {
     ROS_INFO("Convert mesh for link '%s'", link->name.c_str());
 
-    SoNode * allVisuals = urdf2inventor::getAllGeometry(link, scale_factor, addVisualTransform, useVisuals, scaleUrdfTransforms);
+    // meshes used several times within the link are only converted once
+    urdf2inventor::SharedMeshNodes sharedMeshes;
+    SoNode * allVisuals = urdf2inventor::getAllGeometry(link, scale_factor, addVisualTransform, useVisuals, scaleUrdfTransforms,
+                                                        options, meshCache, &sharedMeshes);
     if (!allVisuals)
     {
         ROS_ERROR("Could not get visuals");
@@ -438,7 +726,7 @@ bool convertMeshToIVString(urdf_traverser::LinkPtr& link,
     }
 
     // write the node to IV XML format
-    if (!urdf2inventor::writeInventorFileString(allVisuals, resultIV))
+    if (!urdf2inventor::writeInventorFileString(allVisuals, resultIV, options.binaryOutput))
     {
         ROS_ERROR("Could not get the mesh file content");
         return false;
@@ -453,35 +741,155 @@ bool convertMeshToIVString(urdf_traverser::LinkPtr& link,
 
 
 /**
- * Callback function to be called during recursion incurred in convertMeshes().
- * Only supports string mesh formats with MeshConvertRecursionParams<std::string>.
+ * Adds the mesh converted for the link to the results in \e param
  */
-int convertMeshToIVString(urdf_traverser::RecursionParamsPtr& p)
+bool addLinkMesh(urdf2inventor::MeshConvertRecursionParams<std::string>& param,
+                 const std::string& linkName,
+                 const std::string& resultFileContent,
+                 const std::set<std::string>& textureFiles)
 {
-    typedef urdf2inventor::MeshConvertRecursionParams<std::string> MeshConvertRecursionParamsT;
-    typename MeshConvertRecursionParamsT::Ptr param = baselib_binding_ns::dynamic_pointer_cast<MeshConvertRecursionParamsT>(p);
-    if (!param.get())
+    //ROS_INFO_STREAM("Result file content: "<<resultFileContent);
+    if (!param.resultMeshes.insert(std::make_pair(linkName, resultFileContent)).second)
     {
-        ROS_ERROR("Wrong recursion parameter type");
-        return -1;
+        ROS_ERROR("Could not insert the resulting mesh file for link %s to the map", linkName.c_str());
+        return false;
     }
 
+    param.textureFiles[linkName].insert(textureFiles.begin(), textureFiles.end());
+    return true;
+}
+
+/**
+ * Callback function to be called during recursion incurred in convertMeshes().
+ * Only supports string mesh formats with MeshConvertRecursionParams<std::string>.
+ */
+int convertMeshToIVStringCB(urdf2inventor::MeshConvertRecursionParams<std::string>& param)
+{
     bool useVisuals=true;  // XXX TODO: Parameterize
-    urdf_traverser::LinkPtr link = param->getLink();
+    urdf_traverser::LinkPtr link = param.getLink();
     std::string resultFileContent;
     std::set<std::string> textureFiles;
-    if (!convertMeshToIVString(link, param->factor, param->getVisualTransform(), useVisuals, false, resultFileContent, textureFiles))
+    if (!convertMeshToIVString(link, param.factor, param.getVisualTransform(), useVisuals, false, param.meshOptions, param.meshCache,
+                                resultFileContent, textureFiles))
         return -1;
 
-    //ROS_INFO_STREAM("Result file content: "<<resultFileContent);
-    if (!param->resultMeshes.insert(std::make_pair(link->name, resultFileContent)).second)
-    {
-        ROS_ERROR("Could not insert the resulting mesh file for link %s to the map", link->name.c_str());
+    if (!addLinkMesh(param, link->name, resultFileContent, textureFiles))
         return -1;
+    return 1;
+}
+
+/**
+ * A link to be converted in the parallel mesh conversion, and its results.
+ */
+struct LinkMeshJob
+{
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    urdf_traverser::LinkPtr link;
+    urdf_traverser::EigenTransform visualTransform;
+    std::string resultFileContent;
+    std::set<std::string> textureFiles;
+    bool success;
+};
+
+typedef std::vector<LinkMeshJob, Eigen::aligned_allocator<LinkMeshJob> > LinkMeshJobVector;
+
+/**
+ * Visitor for the traversal in convertMeshes() which collects the links to be converted
+ * in parallel, in the order of the traversal.
+ */
+struct LinkMeshJobCollector
+{
+    int operator()(urdf2inventor::MeshConvertRecursionParams<std::string>& param)
+    {
+        LinkMeshJob job;
+        job.link = param.getLink();
+        // the visual transform may depend on the link, so it is read during the traversal
+        job.visualTransform = param.getVisualTransform();
+        job.success = false;
+        jobs.push_back(job);
+        return 1;
     }
+    LinkMeshJobVector jobs;
+};
 
-    param->textureFiles[link->name].insert(textureFiles.begin(), textureFiles.end());
-    return 1;
+/**
+ * Worker of the parallel mesh conversion: converts links from \e jobs until all links
+ * are taken (or one of the conversions failed). The meshes of the link are imported and
+ * prepared concurrently with the other workers, then the Coin nodes are built and written
+ * while holding the Coin mutex.
+ */
+void convertLinkMeshJobs(LinkMeshJobVector& jobs, const float scale_factor, const bool useVisuals,
+                         const MeshConversionOptions& options, const MeshCachePtr& meshCache,
+                         std::atomic<unsigned int>& nextJob, std::atomic<bool>& failed)
+{
+    unsigned int i;
+    while (!failed && ((i = nextJob++) < jobs.size()))
+    {
+        LinkMeshJob& job = jobs[i];
+        ImportedMeshes meshes;
+        importLinkMeshes(job.link, useVisuals, scale_factor, options, meshCache, meshes);
+
+        std::lock_guard<std::mutex> lock(coinMutex);
+        threadImportedMeshes = &meshes;
+        job.success = convertMeshToIVString(job.link, scale_factor, job.visualTransform, useVisuals, false,
+                                            options, meshCache, job.resultFileContent, job.textureFiles);
+        threadImportedMeshes = NULL;
+        if (!job.success) failed = true;
+    }
+}
+
+/**
+ * Converts the meshes of all links below (and including) \e startLinkName with \e numThreads threads.
+ * The results are added to \e meshParams in the order of the traversal, so they are
+ * the same as with the traversal using convertMeshToIVStringCB().
+ */
+bool convertMeshesParallel(urdf_traverser::UrdfTraverser& traverser,
+                           const std::string& startLinkName,
+                           const unsigned int numThreads,
+                           urdf2inventor::MeshConvertRecursionParams<std::string>& meshParams)
+{
+    bool useVisuals=true;  // XXX TODO: Parameterize
+    LinkMeshJobCollector collector;
+    if (traverser.traverse(startLinkName, collector, meshParams, true) <= 0)
+    {
+        ROS_ERROR("Could not collect links to convert.");
+        return false;
+    }
+    LinkMeshJobVector& jobs = collector.jobs;
+
+    // initialize Coin in this thread before the workers use it
+    SoNodeKit::init();
+
+    ROS_INFO("Converting meshes of %u links with %u threads", static_cast<unsigned int>(jobs.size()),
+             std::min(numThreads, static_cast<unsigned int>(jobs.size())));
+    std::atomic<unsigned int> nextJob(0);
+    std::atomic<bool> failed(false);
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; (t < numThreads) && (t < jobs.size()); ++t)
+    {
+        workers.push_back(std::thread(convertLinkMeshJobs, std::ref(jobs), meshParams.factor, useVisuals,
+                                      std::cref(meshParams.meshOptions), std::cref(meshParams.meshCache),
+                                      std::ref(nextJob), std::ref(failed)));
+    }
+    for (unsigned int t = 0; t < workers.size(); ++t)
+    {
+        workers[t].join();
+    }
+
+    // merge the results in the order of the traversal
+    for (LinkMeshJobVector::iterator it = jobs.begin(); it != jobs.end(); ++it)
+    {
+        if (!it->success)
+        {
+            ROS_ERROR("Could not convert meshes of link %s", it->link->name.c_str());
+            return false;
+        }
+        if (!addLinkMesh(meshParams, it->link->name, it->resultFileContent, it->textureFiles))
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
 #if 0
@@ -552,9 +960,20 @@ bool urdf2inventor::convertMeshes(urdf_traverser::UrdfTraverser& traverser,
         return false;
     }
 
+    unsigned int numThreads = meshParams->numThreads;
+    if (numThreads == 0) numThreads = std::thread::hardware_concurrency();
+    if (numThreads > 1)
+    {
+        if (!convertMeshesParallel(traverser, startLinkName, numThreads, *meshParams))
+        {
+            ROS_ERROR("Could not convert meshes.");
+            return false;
+        }
+        return true;
+    }
+
     // go through entire tree
-    urdf_traverser::RecursionParamsPtr p(meshParams);
-    if (traverser.traverseTreeTopDown(startLinkName, boost::bind(&convertMeshToIVString, _1), p, true) <= 0)
+    if (traverser.traverse(startLinkName, convertMeshToIVStringCB, *meshParams, true) <= 0)
     {
         ROS_ERROR("Could nto convert meshes.");
         return false;
@@ -583,8 +1002,10 @@ bool urdf2inventor::fixTextureReferences(
     urdf_traverser::helpers::enforceDirectory(_relMeshDir, true);
     urdf_traverser::helpers::enforceDirectory(_relTexDir, true);
 
+    // all paths are split into their components only once for all meshes
+    urdf_traverser::helpers::PathTable pathTable;
     std::string commonParent;
-    if (!urdf_traverser::helpers::getCommonParentPath(allTextures, commonParent))
+    if (!pathTable.getCommonParentPath(allTextures, commonParent))
     {
         ROS_ERROR_STREAM("Could not find common parent path of all textures");
         return false;
@@ -609,7 +1030,7 @@ bool urdf2inventor::fixTextureReferences(
         }
 
         if (!urdf2inventor::helpers::fixFileReferences(relMeshInstallFile.str(), _relTexDir, commonParent, it->second,
-                meshString->second, texturesToCopy))
+                meshString->second, texturesToCopy, &pathTable))
         {
             ROS_ERROR_STREAM("Could not fix file references");
             return false;
@@ -29,6 +29,7 @@
  * ------------------------------------------------------------------------------
  **/
 #include <urdf2inventor/Helpers.h>
+#include <urdf2inventor/IVHelpers.h>
 
 #include <ros/ros.h>
 #include <ros/package.h>
@@ -38,8 +39,23 @@
 #undef BOOST_NO_CXX11_SCOPED_ENUMS
 
 #include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 
 /**
@@ -93,98 +109,320 @@ void urdf2inventor::helpers::redirectStdOut(const char * toFile)
     // setvbuf(stdout,toString,_IOFBF,stringSize);
 }
 
+std::string urdf2inventor::helpers::hashData(const char * data, const size_t size)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    for (const char * it = data; it != data + size; ++it)
+    {
+        hash ^= static_cast<unsigned char>(*it);
+        hash *= 1099511628211ULL;
+    }
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", hash);
+    return std::string(hex);
+}
+
+
+
+using urdf2inventor::MeshConversionOptions;
+
+namespace
+{
+
+/**
+ * A file to install with writeFiles()
+ */
+struct FileInstallJob
+{
+    std::string source;
+    boost::filesystem::path target;
+    // status of the source file
+    struct stat sourceStat;
+    // index of the job which installs the same source file (same device and inode)
+    // before this one, or -1 if this job is the first one with this source.
+    int firstWithSource;
+    bool success;
+};
+
+typedef std::vector<FileInstallJob> FileInstallJobVector;
+
+/**
+ * Checks whether the target of \e job is already up to date: a link to the source
+ * (or to \e linkTarget) if \e install links the files, otherwise a regular file
+ * with the same size and modification time as the source.
+ */
+bool isInstalled(const FileInstallJob& job, const MeshConversionOptions::TextureInstall install,
+                 const std::string& linkTarget)
+{
+    struct stat targetStat;
+    if (lstat(job.target.c_str(), &targetStat) != 0) return false;
+    if (install == MeshConversionOptions::TEXTURE_SYMLINK)
+    {
+        if (!S_ISLNK(targetStat.st_mode)) return false;
+        std::vector<char> buf(targetStat.st_size + 1);
+        ssize_t len = readlink(job.target.c_str(), &buf[0], buf.size());
+        return (len >= 0) && (std::string(&buf[0], len) == linkTarget);
+    }
+    if (!S_ISREG(targetStat.st_mode)) return false;
+    if ((targetStat.st_dev == job.sourceStat.st_dev) && (targetStat.st_ino == job.sourceStat.st_ino))
+    {
+        // a hard link to the source
+        return install == MeshConversionOptions::TEXTURE_HARDLINK;
+    }
+    // a copy of the source, which is only up to date for hard links if the source is on another file system
+    if ((install == MeshConversionOptions::TEXTURE_HARDLINK) && (targetStat.st_dev == job.sourceStat.st_dev))
+    {
+        return false;
+    }
+    return (targetStat.st_size == job.sourceStat.st_size) &&
+           (targetStat.st_mtim.tv_sec == job.sourceStat.st_mtim.tv_sec) &&
+           (targetStat.st_mtim.tv_nsec == job.sourceStat.st_mtim.tv_nsec);
+}
+
+/**
+ * Copies \e source to \e target, which must not exist, with the modification time of \e sourceStat,
+ * so that the copy is recognized as up to date by isInstalled(). If \e reflink is true, the copy
+ * is a clone sharing the data of \e source where the file system supports it.
+ */
+bool copyFile(const std::string& source, const struct stat& sourceStat, const std::string& target, const bool reflink)
+{
+    bool cloned = false;
+#ifdef FICLONE
+    if (reflink)
+    {
+        int srcFd = open(source.c_str(), O_RDONLY);
+        int targetFd = (srcFd < 0) ? -1 : open(target.c_str(), O_WRONLY | O_CREAT | O_EXCL, sourceStat.st_mode & 0777);
+        cloned = (targetFd >= 0) && (ioctl(targetFd, FICLONE, srcFd) == 0);
+        if (srcFd >= 0) close(srcFd);
+        if (targetFd >= 0) close(targetFd);
+        if (!cloned && (targetFd >= 0)) unlink(target.c_str());
+    }
+#endif
+    if (!cloned)
+    {
+        try
+        {
+            boost::filesystem::copy_file(source, target);
+        }
+        catch (const boost::filesystem::filesystem_error& ex)
+        {
+            ROS_ERROR_STREAM("Could not copy file: " << ex.what());
+            return false;
+        }
+    }
+    struct timespec times[2] = { sourceStat.st_atim, sourceStat.st_mtim };
+    if (utimensat(AT_FDCWD, target.c_str(), times, 0) != 0)
+    {
+        ROS_WARN_STREAM("Could not set the modification time of " << target << ": " << strerror(errno));
+    }
+    return true;
+}
+
+/**
+ * Installs the file of \e job. If \e firstTarget is not empty, it is the target of the job
+ * which has installed the same source file before, which will be linked instead of copying the source again.
+ */
+bool installFile(const FileInstallJob& job, const MeshConversionOptions::TextureInstall install,
+                 const std::string& firstTarget)
+{
+    const std::string& target = job.target.native();
+    if (isInstalled(job, install, job.source)) return true;
+
+    // remove the old file first, so that files or links from previous installations are replaced
+    // and not written through.
+    if ((unlink(target.c_str()) != 0) && (errno != ENOENT))
+    {
+        ROS_ERROR_STREAM("Could not replace file " << target << ": " << strerror(errno));
+        return false;
+    }
+
+    switch (install)
+    {
+    case MeshConversionOptions::TEXTURE_SYMLINK:
+        if (symlink(job.source.c_str(), target.c_str()) != 0)
+        {
+            ROS_ERROR_STREAM("Could not link " << target << " to " << job.source << ": " << strerror(errno));
+            return false;
+        }
+        return true;
+    case MeshConversionOptions::TEXTURE_HARDLINK:
+        // link the file which the source refers to if it is a symbolic link
+        if (linkat(AT_FDCWD, job.source.c_str(), AT_FDCWD, target.c_str(), AT_SYMLINK_FOLLOW) == 0) return true;
+        ROS_WARN_STREAM("Could not hard link " << target << " to " << job.source << " ("
+                        << strerror(errno) << "), copying the file instead.");
+        break;
+    default:
+        // a copy of a source which has been copied already is a hard link to the first copy
+        if (!firstTarget.empty() && (link(firstTarget.c_str(), target.c_str()) == 0)) return true;
+        break;
+    }
+    return copyFile(job.source, job.sourceStat, target, install == MeshConversionOptions::TEXTURE_REFLINK);
+}
+
+/**
+ * Worker of writeFiles(): installs the files of \e jobs until all of them are taken.
+ * If \e duplicates is false, only the first job of each source file is installed,
+ * otherwise only the other ones.
+ */
+void installFileJobs(FileInstallJobVector& jobs, const MeshConversionOptions::TextureInstall install,
+                     const bool duplicates, std::atomic<unsigned int>& nextJob)
+{
+    unsigned int i;
+    while ((i = nextJob++) < jobs.size())
+    {
+        FileInstallJob& job = jobs[i];
+        if (!job.success || ((job.firstWithSource >= 0) != duplicates)) continue;
+        std::string firstTarget;
+        if (job.firstWithSource >= 0)
+        {
+            const FileInstallJob& first = jobs[job.firstWithSource];
+            if (first.success) firstTarget = first.target.native();
+        }
+        job.success = installFile(job, install, firstTarget);
+    }
+}
 
+}  // namespace
 
-bool urdf2inventor::helpers::writeFiles(const std::map<std::string, std::set<std::string> >& files, const std::string& outputDir)
+bool urdf2inventor::helpers::writeFiles(const std::map<std::string, std::set<std::string> >& files, const std::string& outputDir,
+                                        const MeshConversionOptions::TextureInstall install,
+                                        unsigned int numThreads)
 {
     bool ret = true;
     boost::filesystem::path _outputDir(boost::filesystem::absolute(outputDir));
 
+    FileInstallJobVector jobs;
+    std::set<std::string> targetDirs;
+    // index of the first job for each source file (device and inode)
+    std::map<std::pair<dev_t, ino_t>, int> sourceJobs;
     for (std::map<std::string, std::set<std::string> >::const_iterator mit = files.begin(); mit != files.end(); ++mit)
     {
-        for (std::set<std::string>::const_iterator tit = mit->second.begin(); tit != mit->second.end(); ++tit)
+        if (mit->second.empty()) continue;
+        if (mit->second.size() > 1)
         {
-            boost::filesystem::path fullPath;
-            boost::filesystem::path tFile(mit->first);
-            if (tFile.is_relative())
-            {
-                fullPath = _outputDir;
-            }
-            else
-            {
-                // outputDir should be a superdirectory of tFile, or print a warning
-                std::string testRelParent;
-                if (!urdf_traverser::helpers::getSubdirPath(outputDir, tFile.string(), testRelParent))
-                {
-                    ROS_WARN_STREAM("File " << tFile.string() << " given as absolute path, but it is not in a subdirectory of " << outputDir);
-                }
-            }
-            fullPath /= tFile;
-            // ROS_INFO_STREAM("cp "<<*tit<<" "<<fullPath.string());
+            ROS_WARN_STREAM("Several files to copy to " << mit->first << ", only the last one will be copied.");
+        }
 
-            // first, create directory if needed
-            std::string targetTexDir = urdf_traverser::helpers::getDirectory(fullPath.string());
-            if (!urdf_traverser::helpers::makeDirectoryIfNeeded(targetTexDir.c_str()))
+        FileInstallJob job;
+        job.source = *mit->second.rbegin();
+        boost::filesystem::path tFile(mit->first);
+        if (tFile.is_relative())
+        {
+            job.target = _outputDir;
+        }
+        else
+        {
+            // outputDir should be a superdirectory of tFile, or print a warning
+            std::string testRelParent;
+            if (!urdf_traverser::helpers::getSubdirPath(outputDir, tFile.string(), testRelParent))
             {
-                ROS_ERROR_STREAM("Could not create directory " << targetTexDir);
-                ret = false;
-                continue;
+                ROS_WARN_STREAM("File " << tFile.string() << " given as absolute path, but it is not in a subdirectory of " << outputDir);
             }
+        }
+        job.target /= tFile;
+        // ROS_INFO_STREAM("cp "<<job.source<<" "<<job.target.string());
 
-            try
-            {
-                // copy the file
-                // copy_option::fail_if_exists would be proper but annoying to debug
-                boost::filesystem::copy_file(*tit, fullPath, boost::filesystem::copy_option::overwrite_if_exists);
-            }
-            catch (const boost::filesystem::filesystem_error& ex)
-            {
-                ROS_ERROR_STREAM("Could not copy file: " << ex.what());
-                ret = false;
-                continue;
-            }
+        if (stat(job.source.c_str(), &job.sourceStat) != 0)
+        {
+            ROS_ERROR_STREAM("Could not copy file " << job.source << ": " << strerror(errno));
+            ret = false;
+            continue;
+        }
+        std::pair<std::map<std::pair<dev_t, ino_t>, int>::iterator, bool> first =
+            sourceJobs.insert(std::make_pair(std::make_pair(job.sourceStat.st_dev, job.sourceStat.st_ino),
+                                             static_cast<int>(jobs.size())));
+        job.firstWithSource = first.second ? -1 : first.first->second;
+        job.success = true;
+        targetDirs.insert(job.target.parent_path().string());
+        jobs.push_back(job);
+    }
+
+    // create each target directory once
+    std::set<std::string> failedDirs;
+    for (std::set<std::string>::const_iterator dit = targetDirs.begin(); dit != targetDirs.end(); ++dit)
+    {
+        try
+        {
+            boost::filesystem::create_directories(*dit);
+        }
+        catch (const boost::filesystem::filesystem_error& ex)
+        {
+            ROS_ERROR_STREAM("Could not create directory " << *dit << ": " << ex.what());
+            failedDirs.insert(*dit);
+            ret = false;
+        }
+    }
+    if (!failedDirs.empty())
+    {
+        for (FileInstallJobVector::iterator it = jobs.begin(); it != jobs.end(); ++it)
+        {
+            if (failedDirs.count(it->target.parent_path().string()) > 0) it->success = false;
+        }
+    }
+
+    // install the first target of each source file, then the other ones (which may link to the first)
+    if (numThreads == 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        std::atomic<unsigned int> nextJob(0);
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; (t < numThreads) && (t < jobs.size()); ++t)
+        {
+            workers.push_back(std::thread(installFileJobs, std::ref(jobs), install, pass == 1, std::ref(nextJob)));
+        }
+        for (unsigned int t = 0; t < workers.size(); ++t)
+        {
+            workers[t].join();
         }
     }
 
+    for (FileInstallJobVector::const_iterator it = jobs.begin(); it != jobs.end(); ++it)
+    {
+        if (!it->success) ret = false;
+    }
     return ret;
 }
 
 
-bool urdf2inventor::helpers::fixFileReferences(
+bool urdf2inventor::helpers::getFileReferences(
     const std::string& modelDir,
     const std::string& fileDir,
     const std::string& fileRootDir,
     const std::set<std::string>& filesInUse,
-    std::string& modelString,
-    std::map<std::string, std::set<std::string> >& filesToCopy)
+    std::map<std::string, std::string>& newReferences,
+    std::map<std::string, std::set<std::string> >& filesToCopy,
+    urdf_traverser::helpers::PathTable * pathTable)
 {
     if (filesInUse.empty()) return true;
 
+    urdf_traverser::helpers::PathTable localPathTable;
+    urdf_traverser::helpers::PathTable& paths = pathTable ? *pathTable : localPathTable;
+
     std::string _fileDir(fileDir);
     urdf_traverser::helpers::enforceDirectory(_fileDir, false);
 
     // do error checking first
     std::string testCommonParent;
-    if (!urdf_traverser::helpers::getCommonParentPath(filesInUse, testCommonParent))
+    if (!paths.getCommonParentPath(filesInUse, testCommonParent))
     {
         ROS_ERROR_STREAM("Could not find common parent path of all files");
         return false;
     }
     // test: testCommonParent must be a subdirectory to fileRootDir, or the same directory.
     std::string testRelParent;
-    if (!urdf_traverser::helpers::getSubdirPath(fileRootDir, testCommonParent, testRelParent))
+    if (!paths.getSubdirPath(fileRootDir, testCommonParent, testRelParent))
     {
         ROS_ERROR_STREAM("File " << testCommonParent << " is not in a subdirectory of " << fileRootDir);
         return false;
     }
     // end error checking
 
-    // now iterate through all file files and change references in \e modelString
+    // now iterate through all files and determine their new references
     for (std::set<std::string>::iterator itFile = filesInUse.begin(); itFile != filesInUse.end(); ++itFile)
     {
         std::string absFile = *itFile;
         std::string file;
-        if (!urdf_traverser::helpers::getSubdirPath(fileRootDir, absFile, file))
+        if (!paths.getSubdirPath(fileRootDir, absFile, file))
         {
             ROS_ERROR_STREAM("File " << absFile << " is not in a subdirectory of " << fileRootDir);
             continue;
@@ -195,35 +433,74 @@ bool urdf2inventor::helpers::fixFileReferences(
         filePath << _fileDir << file;
 
         std::string newFileReference;
-        if (!urdf_traverser::helpers::getRelativeDirectory(filePath.str(), modelDir, newFileReference))
+        if (!paths.getRelativeDirectory(filePath.str(), modelDir, newFileReference))
         {
             ROS_ERROR_STREAM("Could not determine relative directory between " << filePath.str()
                              << " and " << modelDir << ".");
             continue;
         }
 
-        // replace all occurrences in mesh string
-        // ROS_INFO_STREAM("Replacing new file reference: "<<newFileReference);
+        newReferences[absFile] = newFileReference;
+
+        // ROS_INFO_STREAM("File to copy to "<<filePath.str()<<" : "<<absFile);
+        // add this file to the result set
+        filesToCopy[filePath.str()].insert(absFile);
+    }
+    return true;
+}
+
+
+bool urdf2inventor::helpers::fixFileReferences(
+    const std::string& modelDir,
+    const std::string& fileDir,
+    const std::string& fileRootDir,
+    const std::set<std::string>& filesInUse,
+    std::string& modelString,
+    std::map<std::string, std::set<std::string> >& filesToCopy,
+    urdf_traverser::helpers::PathTable * pathTable)
+{
+    std::map<std::string, std::string> newReferences;
+    if (!getFileReferences(modelDir, fileDir, fileRootDir, filesInUse, newReferences, filesToCopy, pathTable))
+        return false;
+    if (newReferences.empty()) return true;
+
+    if (urdf2inventor::isBinaryInventorContent(modelString))
+    {
+        // strings in binary content are stored with their length, so they can't be
+        // replaced in the string. Change the references in the scene graph instead.
+        SoNode * model = urdf2inventor::readInventorFileString(modelString);
+        if (!model)
+        {
+            ROS_ERROR_STREAM("Could not read binary model to fix its file references");
+            return false;
+        }
+        model->ref();
+        urdf2inventor::setTexturePaths(model, newReferences);
+        bool success = urdf2inventor::writeInventorFileString(model, modelString, true);
+        model->unref();
+        if (!success) ROS_ERROR_STREAM("Could not write binary model after fixing its file references");
+        return success;
+    }
 
-        // first, replace all full filenames with paths
-        modelString = urdf_traverser::helpers::replaceAll(modelString,
-                      absFile, newFileReference);
+    // replace all occurrences in the model string, in one pass for all files
+    std::map<std::string, std::string> replacements(newReferences);
+    for (std::map<std::string, std::string>::iterator it = newReferences.begin(); it != newReferences.end(); ++it)
+    {
+        const std::string& absFile = it->first;
+        const std::string& newFileReference = it->second;
 
-        // now, replace all remaining occurrences of the path with a version without
-        // path separators (this is only in case there is left-over names made up of the path)
+        // also replace all remaining occurrences of the path without extension with a version
+        // without path separators (this is only in case there is left-over names made up of the path).
+        // Full file names take precedence, as they are the longer match.
         boost::filesystem::path _absFileMod(absFile);
         _absFileMod.replace_extension("");
         boost::filesystem::path _texRefMod(newFileReference);
         _texRefMod.replace_extension("");
         std::string texRefMod = urdf_traverser::helpers::replaceAll(_texRefMod.string(), "/", "_");
         texRefMod = urdf_traverser::helpers::replaceAll(texRefMod, ".", "_");
-        modelString = urdf_traverser::helpers::replaceAll(modelString,
-                      _absFileMod.string(), texRefMod);
-
-        // ROS_INFO_STREAM("File to copy to "<<filePath.str()<<" : "<<absFile);
-        // add this file to the result set
-        filesToCopy[filePath.str()].insert(absFile);
+        replacements.insert(std::make_pair(_absFileMod.string(), texRefMod));
     }
+    modelString = urdf_traverser::helpers::replaceAll(modelString, replacements);
     return true;
 }
 
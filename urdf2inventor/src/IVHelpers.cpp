@@ -36,6 +36,10 @@
 #include <Inventor/nodes/SoCube.h>
 #include <Inventor/nodes/SoCylinder.h>
 #include <Inventor/nodes/SoTexture2.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+#include <Inventor/nodes/SoIndexedShape.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
 
 
 #include <Inventor/actions/SoWriteAction.h>
@@ -44,7 +48,9 @@
 #include <Inventor/actions/SoGetBoundingBoxAction.h>
 
 #include <iostream>
+#include <set>
 #include <sstream>
+#include <string>
 
 #define BOOST_NO_CXX11_SCOPED_ENUMS
 #include <boost/filesystem.hpp>
@@ -68,31 +74,137 @@ void urdf2inventor::getBoundingBox(SoNode* node, Eigen::Vector3d& minPoint, Eige
 }
 
 
-bool urdf2inventor::writeInventorFileString(SoNode * node, std::string& result)
+/**
+ * Estimates the size of the inventor file content of \e node from the number of vertices,
+ * normals, texture coordinates and indices in it. Nodes used several times are written once.
+ */
+static size_t estimateInventorFileSize(SoNode * node, bool binary)
 {
+    // approximate number of bytes per written float and index
+    const size_t floatSize = binary ? 4 : 11;
+    const size_t indexSize = binary ? 4 : 7;
+    size_t size = 4096;
+
+    std::set<SoNode*> counted;
+    SoSearchAction sa;
+    sa.setType(SoVertexProperty::getClassTypeId());
+    sa.setInterest(SoSearchAction::ALL);
+    sa.setSearchingAll(TRUE);
+    sa.apply(node);
+    SoPathList & props = sa.getPaths();
+    for (int i = 0; i < props.getLength(); i++)
+    {
+        SoVertexProperty * prop = (SoVertexProperty*) ((SoFullPath*) props[i])->getTail();
+        if (!counted.insert(prop).second) continue;
+        size += floatSize * (3 * prop->vertex.getNum() + 3 * prop->normal.getNum() +
+                             2 * prop->texCoord.getNum() + 3 * prop->texCoord3.getNum());
+    }
+    sa.reset();
+
+    sa.setType(SoIndexedShape::getClassTypeId());
+    sa.apply(node);
+    SoPathList & shapes = sa.getPaths();
+    for (int i = 0; i < shapes.getLength(); i++)
+    {
+        SoIndexedShape * shape = (SoIndexedShape*) ((SoFullPath*) shapes[i])->getTail();
+        if (!counted.insert(shape).second) continue;
+        size += indexSize * (shape->coordIndex.getNum() + shape->normalIndex.getNum() +
+                             shape->textureCoordIndex.getNum());
+    }
+    sa.reset();
+    return size;
+}
+
+// The string which SoOutput writes into in writeInventorFileString(). The realloc function
+// of SoOutput has no user data, so the string is passed to it in this variable.
+static thread_local std::string * outputString = NULL;
+
+/**
+ * Realloc function for SoOutput which resizes outputString, so that the content is written
+ * directly into the string and does not have to be copied once it has been written.
+ */
+static void * reallocOutputString(void *, size_t size)
+{
+    outputString->resize(size);
+    return &(*outputString)[0];
+}
+
+bool urdf2inventor::writeInventorFileString(SoNode * node, std::string& result, bool binary)
+{
+    // the buffer is presized to the estimated size, so that it rarely has to grow
+    // (which SoOutput does by doubling its size).
+    result.clear();
+    result.resize(estimateInventorFileSize(node, binary));
+    outputString = &result;
+
     SoOutput out;
-    out.setBinary(false);
-    size_t initBufSize = 100;
-    void * buffer = malloc(initBufSize * sizeof(char));
-    out.setBuffer(buffer, initBufSize, std::realloc);
+    out.setBinary(binary);
+    out.setBuffer(&result[0], result.size(), reallocOutputString);
     SoWriteAction write(&out);
     write.apply(node);
 
     void * resBuf = NULL;
     size_t resBufSize = 0;
-
-    if (!out.getBuffer(resBuf, resBufSize) || (resBufSize == 0))
+    bool success = out.getBuffer(resBuf, resBufSize) && (resBufSize > 0);
+    outputString = NULL;
+    if (!success)
     {
+        result.clear();
         return false;
     }
 
-    result = std::string(static_cast<char*>(resBuf), resBufSize);  // buffer will be copied
+    result.resize(resBufSize);
+    return true;
+}
 
-    free(resBuf);
+bool urdf2inventor::writeInventorFile(SoNode * node, const std::string& filename, bool binary)
+{
+    std::string dir = urdf_traverser::helpers::getDirectory(filename);
+    if (!dir.empty() && !urdf_traverser::helpers::makeDirectoryIfNeeded(dir.c_str()))
+    {
+        return false;
+    }
 
+    SoOutput out;
+    if (!out.openFile(filename.c_str())) return false;
+    out.setBinary(binary);
+    SoWriteAction write(&out);
+    write.apply(node);
+    out.closeFile();
     return true;
 }
 
+bool urdf2inventor::isBinaryInventorContent(const std::string& content)
+{
+    // the header line is "#Inventor V<version> binary"
+    std::string::size_type eol = content.find('\n');
+    std::string header = content.substr(0, eol);
+    return (header.compare(0, 10, "#Inventor ") == 0) && (header.find(" binary") != std::string::npos);
+}
+
+SoNode * urdf2inventor::readInventorFileString(const std::string& content)
+{
+    SoInput in;
+    in.setBuffer(const_cast<char*>(content.data()), content.size());
+    SoSeparator * root = SoDB::readAll(&in);
+    if (!root)
+    {
+        return NULL;
+    }
+    if (root->getNumChildren() != 1)
+    {
+        return root;
+    }
+
+    // return the only top-level node instead of the separator added by readAll()
+    SoNode * node = root->getChild(0);
+    node->ref();
+    root->ref();
+    root->unref();
+    node->unrefNoDelete();
+    return node;
+}
+
 
 
 
@@ -126,6 +238,40 @@ std::set<std::string> urdf2inventor::getAllTexturePaths(SoNode * root)
     return allFiles;
 }
 
+unsigned int urdf2inventor::setTexturePaths(SoNode * root, const std::map<std::string, std::string>& newPaths)
+{
+    unsigned int numChanged = 0;
+    SoSearchAction sa;
+    sa.setType(SoTexture2::getClassTypeId());
+    sa.setInterest(SoSearchAction::ALL);
+    sa.setSearchingAll(TRUE);
+    sa.apply(root);
+    SoPathList & pl = sa.getPaths();
+
+    for (int i = 0; i < pl.getLength(); i++)
+    {
+        SoFullPath * p = (SoFullPath*) pl[i];
+        if (!p->getTail()->isOfType(SoTexture2::getClassTypeId())) continue;
+
+        SoTexture2 * tex = (SoTexture2*) p->getTail();
+        if (tex->filename.getValue().getLength() == 0) continue;
+
+        std::string name(tex->filename.getValue().getString());
+        boost::filesystem::path absPath(boost::filesystem::absolute(name));
+        std::map<std::string, std::string>::const_iterator newPath = newPaths.find(absPath.string());
+        if (newPath == newPaths.end()) continue;
+
+        // SoTexture2 loads the image when the file name changes. The new name
+        // is relative to the output file, so it can't be loaded from here.
+        tex->filename.enableNotify(FALSE);
+        tex->filename.setValue(newPath->second.c_str());
+        tex->filename.enableNotify(TRUE);
+        ++numChanged;
+    }
+    sa.reset();
+    return numChanged;
+}
+
 std::string urdf2inventor::printMatrix(const urdf2inventor::EigenTransform& em)
 {
     std::stringstream s;
@@ -0,0 +1,170 @@
+/**
+ * <ORGANIZATION> = Jennifer Buehler 
+ * <COPYRIGHT HOLDER> = Jennifer Buehler 
+ * 
+ * Copyright (c) 2016 Jennifer Buehler 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <ORGANIZATION> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ------------------------------------------------------------------------------
+ **/
+#include <urdf2inventor/MeshCache.h>
+#include <urdf2inventor/Helpers.h>
+#include <urdf_traverser/Helpers.h>
+
+#include <ros/ros.h>
+
+#include <sstream>
+#include <string>
+
+#define BOOST_NO_CXX11_SCOPED_ENUMS
+#include <boost/filesystem.hpp>
+#undef BOOST_NO_CXX11_SCOPED_ENUMS
+
+using urdf2inventor::MeshCache;
+
+/**
+ * 64 bit FNV-1a hash of \e data, as hexadecimal string.
+ */
+static std::string hashString(const std::string& data)
+{
+    return urdf2inventor::helpers::hashData(data.data(), data.size());
+}
+
+std::string MeshCache::getCacheFilename(const std::string& key) const
+{
+    return (boost::filesystem::path(directory) / (key + ".iv")).string();
+}
+
+bool MeshCache::getKey(const std::string& meshFilename, const std::string& settings, std::string& key)
+{
+    boost::system::error_code err;
+    std::time_t modificationTime = boost::filesystem::last_write_time(meshFilename, err);
+    unsigned long long size = 0;
+    if (!err) size = boost::filesystem::file_size(meshFilename, err);
+    if (err)
+    {
+        ROS_ERROR_STREAM("Could not access mesh file " << meshFilename << ": " << err.message());
+        return false;
+    }
+
+    std::string fileHash;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::map<std::string, FileHash>::const_iterator it = fileHashes.find(meshFilename);
+        if ((it != fileHashes.end()) && (it->second.modificationTime == modificationTime)
+                && (it->second.size == size))
+            fileHash = it->second.hash;
+    }
+
+    if (fileHash.empty())
+    {
+        // the file is read without holding the lock, so other threads can look up meshes meanwhile
+        std::string content;
+        if (!urdf_traverser::helpers::readFromFile(meshFilename, content))
+        {
+            ROS_ERROR_STREAM("Could not read mesh file " << meshFilename);
+            return false;
+        }
+        FileHash newHash;
+        newHash.modificationTime = modificationTime;
+        newHash.size = size;
+        newHash.hash = hashString(content);
+        fileHash = newHash.hash;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        fileHashes[meshFilename] = newHash;
+    }
+
+    std::stringstream str;
+    str << fileHash << "-" << std::hex << size << "-" << hashString(settings);
+    key = str.str();
+    return true;
+}
+
+bool MeshCache::has(const std::string& key)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (meshes.find(key) != meshes.end()) return true;
+    }
+    return !directory.empty() && boost::filesystem::exists(getCacheFilename(key));
+}
+
+bool MeshCache::get(const std::string& key, std::string& ivContent)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::map<std::string, std::string>::const_iterator it = meshes.find(key);
+        if (it != meshes.end())
+        {
+            ivContent = it->second;
+            return true;
+        }
+    }
+
+    if (directory.empty()) return false;
+    std::string filename = getCacheFilename(key);
+    if (!boost::filesystem::exists(filename) || !urdf_traverser::helpers::readFromFile(filename, ivContent))
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    meshes[key] = ivContent;
+    return true;
+}
+
+bool MeshCache::add(const std::string& key, const std::string& ivContent)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        meshes[key] = ivContent;
+    }
+
+    if (directory.empty()) return true;
+
+    // write to a temporary file first and then rename it, so that other processes
+    // using the same cache directory never read an incomplete file
+    std::string filename = getCacheFilename(key);
+    std::string tmpFilename = boost::filesystem::unique_path(filename + ".%%%%-%%%%-%%%%.tmp").string();
+    if (!urdf_traverser::helpers::writeToFile(ivContent, tmpFilename))
+    {
+        ROS_ERROR_STREAM("Could not write converted mesh to cache file " << tmpFilename);
+        return false;
+    }
+    boost::system::error_code err;
+    boost::filesystem::rename(tmpFilename, filename, err);
+    if (err)
+    {
+        ROS_ERROR_STREAM("Could not move converted mesh to cache file " << filename << ": " << err.message());
+        boost::filesystem::remove(tmpFilename, err);
+        return false;
+    }
+    return true;
+}
+
+void MeshCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    meshes.clear();
+    fileHashes.clear();
+}
@@ -0,0 +1,590 @@
+/**
+ * <ORGANIZATION> = Jennifer Buehler 
+ * <COPYRIGHT HOLDER> = Jennifer Buehler 
+ * 
+ * Copyright (c) 2016 Jennifer Buehler 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <ORGANIZATION> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ------------------------------------------------------------------------------
+ **/
+#include <urdf2inventor/MeshSimplification.h>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/LU>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <vector>
+
+// Weight of the planes which are added to the quadrics at the borders of open
+// meshes, relative to the planes of the triangles, to preserve the borders.
+#define BORDER_WEIGHT 1000.0
+
+// Minimum cosine of the angle between the normals of a triangle before and after
+// an edge collapse. Collapses which rotate triangles more than this are rejected.
+#define MIN_NORMAL_COS 0.2
+
+/**
+ * Error quadric of a vertex (Garland and Heckbert): the symmetric 4x4 matrix Q for which
+ * the error of a position p is [p 1] * Q * [p 1]^T. Only the upper triangle is stored.
+ */
+class Quadric
+{
+public:
+    Quadric()
+    {
+        std::fill(m, m + 10, 0.0);
+    }
+
+    /**
+     * Quadric of the squared distance to the plane n*p + d = 0, weighted with \e w
+     */
+    Quadric(const Eigen::Vector3d& n, const double d, const double w)
+    {
+        m[0] = w * n.x() * n.x();
+        m[1] = w * n.x() * n.y();
+        m[2] = w * n.x() * n.z();
+        m[3] = w * n.x() * d;
+        m[4] = w * n.y() * n.y();
+        m[5] = w * n.y() * n.z();
+        m[6] = w * n.y() * d;
+        m[7] = w * n.z() * n.z();
+        m[8] = w * n.z() * d;
+        m[9] = w * d * d;
+    }
+
+    Quadric& operator+=(const Quadric& o)
+    {
+        for (unsigned int i = 0; i < 10; ++i) m[i] += o.m[i];
+        return *this;
+    }
+
+    double getError(const Eigen::Vector3d& p) const
+    {
+        return m[0] * p.x() * p.x() + 2 * m[1] * p.x() * p.y() + 2 * m[2] * p.x() * p.z() + 2 * m[3] * p.x()
+               + m[4] * p.y() * p.y() + 2 * m[5] * p.y() * p.z() + 2 * m[6] * p.y()
+               + m[7] * p.z() * p.z() + 2 * m[8] * p.z()
+               + m[9];
+    }
+
+    /**
+     * Gets the position with the minimum error.
+     * \return false if it is not unique (the quadric is singular)
+     */
+    bool getMinimum(Eigen::Vector3d& p) const
+    {
+        Eigen::Matrix3d a;
+        a << m[0], m[1], m[2],
+             m[1], m[4], m[5],
+             m[2], m[5], m[7];
+        Eigen::FullPivLU<Eigen::Matrix3d> lu(a);
+        lu.setThreshold(1e-10);
+        if (!lu.isInvertible()) return false;
+        p = lu.solve(Eigen::Vector3d(-m[3], -m[6], -m[8]));
+        return true;
+    }
+
+private:
+    double m[10];
+};
+
+/**
+ * Collapse of the edge between two vertices in the queue of the simplification. It is only
+ * valid as long as the vertices have not been changed since it was added to the queue.
+ */
+struct EdgeCollapse
+{
+    double cost;
+    unsigned int v0, v1;
+    unsigned int stamp0, stamp1;
+
+    // the queue has to return the collapse with the lowest cost first
+    bool operator<(const EdgeCollapse& o) const
+    {
+        return cost > o.cost;
+    }
+};
+
+/**
+ * Simplification of a triangle mesh by repeatedly collapsing the edge with the lowest
+ * quadric error.
+ */
+class QuadricSimplifier
+{
+public:
+    explicit QuadricSimplifier(const aiMesh * _mesh);
+
+    /**
+     * Collapses edges until the mesh has at most \e targetFaces faces or no edge can be collapsed.
+     */
+    void simplify(const unsigned int targetFaces);
+
+    /**
+     * Creates the simplified mesh
+     */
+    aiMesh * getMesh() const;
+
+    unsigned int getNumFaces() const
+    {
+        return numFaces;
+    }
+
+private:
+    /**
+     * Joins the vertices of the mesh at the same position
+     * \param joined the index of the joined vertex for each vertex of the mesh
+     */
+    void joinVertices(std::vector<unsigned int>& joined);
+
+    /**
+     * Gets the position to collapse the edge to and the error of this position
+     */
+    void getCollapse(const unsigned int v0, const unsigned int v1, Eigen::Vector3d& pos, double& cost) const;
+
+    void addCollapse(const unsigned int v0, const unsigned int v1);
+
+    /**
+     * Gets the vertices of the faces of \e v, other than \e v, sorted. Each vertex is in the
+     * result as many times as it shares an edge of a face with \e v.
+     */
+    void getNeighbours(const unsigned int v, std::vector<unsigned int>& neighbours) const;
+
+    /**
+     * \return true if the edge collapse keeps the topology of the mesh, and does not flip faces.
+     */
+    bool canCollapse(const unsigned int v0, const unsigned int v1, const Eigen::Vector3d& pos);
+
+    /**
+     * \return true if a face of \e v which is not a face of \e vOther is flipped or becomes
+     *      degenerate when moving \e v to \e pos
+     */
+    bool flipsFace(const unsigned int v, const unsigned int vOther, const Eigen::Vector3d& pos) const;
+
+    /**
+     * Collapses \e v1 into \e v0, which moves to \e pos
+     */
+    void collapse(const unsigned int v0, const unsigned int v1, const Eigen::Vector3d& pos);
+
+    const aiMesh * mesh;
+
+    // position, error quadric and index of the vertex in the mesh (to take the attributes of
+    // the vertex from) for each of the joined vertices
+    std::vector<Eigen::Vector3d> positions;
+    std::vector<Quadric> quadrics;
+    std::vector<unsigned int> meshVertices;
+    // faces of each vertex. Faces are not removed from these when they are removed from the
+    // mesh, so they have to be checked with removedFaces.
+    std::vector<std::vector<unsigned int> > vertexFaces;
+    // counter which is incremented when the vertex changes, to invalidate its edge collapses
+    std::vector<unsigned int> stamps;
+    std::vector<bool> removedVertices;
+
+    // three vertex indices per face
+    std::vector<unsigned int> faces;
+    std::vector<bool> removedFaces;
+    unsigned int numFaces;
+
+    std::priority_queue<EdgeCollapse> queue;
+
+    // buffers of canCollapse()
+    std::vector<unsigned int> neighbours0, neighbours1;
+};
+
+QuadricSimplifier::QuadricSimplifier(const aiMesh * _mesh):
+    mesh(_mesh),
+    numFaces(0)
+{
+    std::vector<unsigned int> joined;
+    joinVertices(joined);
+
+    faces.reserve(mesh->mNumFaces * 3);
+    for (unsigned int i = 0; i < mesh->mNumFaces; ++i)
+    {
+        const aiFace& face = mesh->mFaces[i];
+        if (face.mNumIndices != 3) continue;
+        unsigned int v[3] = {joined[face.mIndices[0]], joined[face.mIndices[1]], joined[face.mIndices[2]]};
+        // faces which are degenerate after joining the vertices are left out
+        if ((v[0] == v[1]) || (v[1] == v[2]) || (v[0] == v[2])) continue;
+        faces.insert(faces.end(), v, v + 3);
+    }
+    numFaces = faces.size() / 3;
+    removedFaces.resize(numFaces, false);
+
+    // error quadrics of the faces, weighted with their area, and edges of the faces
+    // (the vertex with the lower index first).
+    quadrics.resize(positions.size());
+    vertexFaces.resize(positions.size());
+    std::vector<Eigen::Vector3d> faceNormals(numFaces);
+    std::vector<std::pair<std::pair<unsigned int, unsigned int>, unsigned int> > edges;
+    edges.reserve(faces.size());
+    for (unsigned int f = 0; f < numFaces; ++f)
+    {
+        const unsigned int * v = &faces[f * 3];
+        Eigen::Vector3d n = (positions[v[1]] - positions[v[0]]).cross(positions[v[2]] - positions[v[0]]);
+        double area = n.norm() / 2;
+        if (area > 0) n.normalize();
+        faceNormals[f] = n;
+        Quadric q(n, -n.dot(positions[v[0]]), area);
+        for (unsigned int k = 0; k < 3; ++k)
+        {
+            quadrics[v[k]] += q;
+            vertexFaces[v[k]].push_back(f);
+            unsigned int w = v[(k + 1) % 3];
+            edges.push_back(std::make_pair(std::make_pair(std::min(v[k], w), std::max(v[k], w)), f));
+        }
+    }
+
+    // planes perpendicular to the faces are added at the borders of the mesh (the edges
+    // which are part of one face only), and all edges are added to the queue of collapses.
+    std::sort(edges.begin(), edges.end());
+    stamps.resize(positions.size(), 0);
+    removedVertices.resize(positions.size(), false);
+    for (unsigned int i = 0; i < edges.size();)
+    {
+        unsigned int j = i + 1;
+        while ((j < edges.size()) && (edges[j].first == edges[i].first)) ++j;
+        const unsigned int v0 = edges[i].first.first;
+        const unsigned int v1 = edges[i].first.second;
+        if (j == i + 1)
+        {
+            Eigen::Vector3d edge = positions[v1] - positions[v0];
+            Eigen::Vector3d n = edge.cross(faceNormals[edges[i].second]);
+            if (n.norm() > 0)
+            {
+                n.normalize();
+                Quadric q(n, -n.dot(positions[v0]), BORDER_WEIGHT * edge.squaredNorm());
+                quadrics[v0] += q;
+                quadrics[v1] += q;
+            }
+        }
+        i = j;
+    }
+    for (unsigned int i = 0; i < edges.size(); ++i)
+    {
+        if ((i > 0) && (edges[i].first == edges[i - 1].first)) continue;
+        addCollapse(edges[i].first.first, edges[i].first.second);
+    }
+}
+
+/**
+ * Compares the positions of the vertices of a mesh
+ */
+class VertexPositionLess
+{
+public:
+    explicit VertexPositionLess(const aiVector3D * _vertices): vertices(_vertices) {}
+    bool operator()(const unsigned int i, const unsigned int j) const
+    {
+        const aiVector3D& a = vertices[i];
+        const aiVector3D& b = vertices[j];
+        if (a.x != b.x) return a.x < b.x;
+        if (a.y != b.y) return a.y < b.y;
+        return a.z < b.z;
+    }
+private:
+    const aiVector3D * vertices;
+};
+
+void QuadricSimplifier::joinVertices(std::vector<unsigned int>& joined)
+{
+    std::vector<unsigned int> order(mesh->mNumVertices);
+    for (unsigned int i = 0; i < mesh->mNumVertices; ++i) order[i] = i;
+    VertexPositionLess less(mesh->mVertices);
+    std::sort(order.begin(), order.end(), less);
+
+    joined.resize(mesh->mNumVertices);
+    for (unsigned int i = 0; i < order.size(); ++i)
+    {
+        const unsigned int v = order[i];
+        if ((i == 0) || less(order[i - 1], v))
+        {
+            const aiVector3D& p = mesh->mVertices[v];
+            positions.push_back(Eigen::Vector3d(p.x, p.y, p.z));
+            meshVertices.push_back(v);
+        }
+        joined[v] = positions.size() - 1;
+    }
+}
+
+void QuadricSimplifier::getCollapse(const unsigned int v0, const unsigned int v1,
+                                    Eigen::Vector3d& pos, double& cost) const
+{
+    Quadric q = quadrics[v0];
+    q += quadrics[v1];
+    const Eigen::Vector3d& p0 = positions[v0];
+    const Eigen::Vector3d& p1 = positions[v1];
+
+    // the optimal position is only used if it is close to the edge, otherwise
+    // the quadric is nearly singular. The ends and the middle of the edge are candidates as well.
+    Eigen::Vector3d mid = (p0 + p1) / 2;
+    Eigen::Vector3d candidates[4] = {p0, p1, mid, mid};
+    unsigned int numCandidates = 3;
+    if (q.getMinimum(candidates[3]) && ((candidates[3] - mid).squaredNorm() <= (p1 - p0).squaredNorm()))
+        numCandidates = 4;
+
+    cost = std::numeric_limits<double>::max();
+    for (unsigned int i = 0; i < numCandidates; ++i)
+    {
+        double error = q.getError(candidates[i]);
+        if (error < cost)
+        {
+            cost = error;
+            pos = candidates[i];
+        }
+    }
+    // rounding errors can make the error slightly negative
+    cost = std::max(cost, 0.0);
+}
+
+void QuadricSimplifier::addCollapse(const unsigned int v0, const unsigned int v1)
+{
+    EdgeCollapse c;
+    Eigen::Vector3d pos;
+    getCollapse(v0, v1, pos, c.cost);
+    c.v0 = v0;
+    c.v1 = v1;
+    c.stamp0 = stamps[v0];
+    c.stamp1 = stamps[v1];
+    queue.push(c);
+}
+
+void QuadricSimplifier::getNeighbours(const unsigned int v, std::vector<unsigned int>& neighbours) const
+{
+    neighbours.clear();
+    for (std::vector<unsigned int>::const_iterator f = vertexFaces[v].begin(); f != vertexFaces[v].end(); ++f)
+    {
+        if (removedFaces[*f]) continue;
+        for (unsigned int k = 0; k < 3; ++k)
+        {
+            if (faces[*f * 3 + k] != v) neighbours.push_back(faces[*f * 3 + k]);
+        }
+    }
+    std::sort(neighbours.begin(), neighbours.end());
+}
+
+/**
+ * \param neighbours sorted result of getNeighbours()
+ * \return true if the vertex is on the border of the mesh, i.e. it has an edge which is part of one face only
+ */
+bool isBorderVertex(const std::vector<unsigned int>& neighbours)
+{
+    for (unsigned int i = 0; i < neighbours.size();)
+    {
+        unsigned int j = i + 1;
+        while ((j < neighbours.size()) && (neighbours[j] == neighbours[i])) ++j;
+        if (j == i + 1) return true;
+        i = j;
+    }
+    return false;
+}
+
+bool QuadricSimplifier::flipsFace(const unsigned int v, const unsigned int vOther, const Eigen::Vector3d& pos) const
+{
+    for (std::vector<unsigned int>::const_iterator f = vertexFaces[v].begin(); f != vertexFaces[v].end(); ++f)
+    {
+        if (removedFaces[*f]) continue;
+        const unsigned int * fv = &faces[*f * 3];
+        if ((fv[0] == vOther) || (fv[1] == vOther) || (fv[2] == vOther)) continue;
+        Eigen::Vector3d p[3], moved[3];
+        for (unsigned int k = 0; k < 3; ++k)
+        {
+            p[k] = positions[fv[k]];
+            moved[k] = (fv[k] == v) ? pos : p[k];
+        }
+        Eigen::Vector3d n = (p[1] - p[0]).cross(p[2] - p[0]);
+        Eigen::Vector3d nMoved = (moved[1] - moved[0]).cross(moved[2] - moved[0]);
+        double len = n.norm() * nMoved.norm();
+        if ((len == 0) || (n.dot(nMoved) < MIN_NORMAL_COS * len)) return true;
+    }
+    return false;
+}
+
+bool QuadricSimplifier::canCollapse(const unsigned int v0, const unsigned int v1, const Eigen::Vector3d& pos)
+{
+    getNeighbours(v0, neighbours0);
+    getNeighbours(v1, neighbours1);
+
+    // number of faces of the edge, which are removed by the collapse
+    unsigned int edgeFaces = std::count(neighbours0.begin(), neighbours0.end(), v1);
+    if (edgeFaces == 0) return false;
+
+    // two border vertices may only be joined along the border
+    if ((edgeFaces > 1) && isBorderVertex(neighbours0) && isBorderVertex(neighbours1)) return false;
+
+    // the vertices may only have the vertices of the faces of the edge in common,
+    // otherwise the collapse creates non-manifold edges
+    std::vector<unsigned int>::iterator end0 = std::unique(neighbours0.begin(), neighbours0.end());
+    std::vector<unsigned int>::iterator end1 = std::unique(neighbours1.begin(), neighbours1.end());
+    unsigned int common = 0;
+    for (std::vector<unsigned int>::iterator i0 = neighbours0.begin(), i1 = neighbours1.begin(); (i0 != end0) && (i1 != end1);)
+    {
+        if (*i0 < *i1) ++i0;
+        else if (*i1 < *i0) ++i1;
+        else
+        {
+            ++common;
+            ++i0;
+            ++i1;
+        }
+    }
+    if (common != edgeFaces) return false;
+
+    // collapsing a tetrahedron would leave two faces on top of each other
+    if ((end0 - neighbours0.begin() <= 3) && (end1 - neighbours1.begin() <= 3)) return false;
+
+    return !flipsFace(v0, v1, pos) && !flipsFace(v1, v0, pos);
+}
+
+void QuadricSimplifier::collapse(const unsigned int v0, const unsigned int v1, const Eigen::Vector3d& pos)
+{
+    // the attributes are taken from the vertex which is closer to the new position
+    if ((pos - positions[v1]).squaredNorm() < (pos - positions[v0]).squaredNorm())
+        meshVertices[v0] = meshVertices[v1];
+    positions[v0] = pos;
+    quadrics[v0] += quadrics[v1];
+
+    std::vector<unsigned int>& faces0 = vertexFaces[v0];
+    std::vector<unsigned int>& faces1 = vertexFaces[v1];
+    for (std::vector<unsigned int>::iterator f = faces1.begin(); f != faces1.end(); ++f)
+    {
+        if (removedFaces[*f]) continue;
+        unsigned int * fv = &faces[*f * 3];
+        if ((fv[0] == v0) || (fv[1] == v0) || (fv[2] == v0))
+        {
+            removedFaces[*f] = true;
+            --numFaces;
+            continue;
+        }
+        for (unsigned int k = 0; k < 3; ++k)
+        {
+            if (fv[k] == v1) fv[k] = v0;
+        }
+        faces0.push_back(*f);
+    }
+    std::vector<unsigned int>().swap(faces1);
+    removedVertices[v1] = true;
+
+    unsigned int numFaces0 = 0;
+    for (unsigned int i = 0; i < faces0.size(); ++i)
+    {
+        if (!removedFaces[faces0[i]]) faces0[numFaces0++] = faces0[i];
+    }
+    faces0.resize(numFaces0);
+
+    // the collapses of all edges of v0 have changed
+    ++stamps[v0];
+    getNeighbours(v0, neighbours0);
+    std::vector<unsigned int>::iterator end = std::unique(neighbours0.begin(), neighbours0.end());
+    for (std::vector<unsigned int>::iterator n = neighbours0.begin(); n != end; ++n)
+        addCollapse(v0, *n);
+}
+
+void QuadricSimplifier::simplify(const unsigned int targetFaces)
+{
+    while ((numFaces > targetFaces) && !queue.empty())
+    {
+        EdgeCollapse c = queue.top();
+        queue.pop();
+        if (removedVertices[c.v0] || removedVertices[c.v1] ||
+                (stamps[c.v0] != c.stamp0) || (stamps[c.v1] != c.stamp1))
+            continue;
+        Eigen::Vector3d pos;
+        double cost;
+        getCollapse(c.v0, c.v1, pos, cost);
+        if (!canCollapse(c.v0, c.v1, pos)) continue;
+        collapse(c.v0, c.v1, pos);
+    }
+}
+
+aiMesh * QuadricSimplifier::getMesh() const
+{
+    // index of each joined vertex in the simplified mesh
+    std::vector<unsigned int> indices(positions.size(), std::numeric_limits<unsigned int>::max());
+    std::vector<unsigned int> usedVertices;
+    for (unsigned int f = 0; f < removedFaces.size(); ++f)
+    {
+        if (removedFaces[f]) continue;
+        for (unsigned int k = 0; k < 3; ++k)
+        {
+            unsigned int v = faces[f * 3 + k];
+            if (indices[v] != std::numeric_limits<unsigned int>::max()) continue;
+            indices[v] = usedVertices.size();
+            usedVertices.push_back(v);
+        }
+    }
+
+    aiMesh * result = new aiMesh();
+    result->mName = mesh->mName;
+    result->mMaterialIndex = mesh->mMaterialIndex;
+    result->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+
+    result->mNumVertices = usedVertices.size();
+    result->mVertices = new aiVector3D[result->mNumVertices];
+    for (unsigned int i = 0; i < usedVertices.size(); ++i)
+    {
+        const Eigen::Vector3d& p = positions[usedVertices[i]];
+        result->mVertices[i] = aiVector3D(p.x(), p.y(), p.z());
+    }
+    for (unsigned int c = 0; c < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++c)
+    {
+        if (!mesh->mTextureCoords[c]) continue;
+        result->mNumUVComponents[c] = mesh->mNumUVComponents[c];
+        result->mTextureCoords[c] = new aiVector3D[result->mNumVertices];
+        for (unsigned int i = 0; i < usedVertices.size(); ++i)
+            result->mTextureCoords[c][i] = mesh->mTextureCoords[c][meshVertices[usedVertices[i]]];
+    }
+    for (unsigned int c = 0; c < AI_MAX_NUMBER_OF_COLOR_SETS; ++c)
+    {
+        if (!mesh->mColors[c]) continue;
+        result->mColors[c] = new aiColor4D[result->mNumVertices];
+        for (unsigned int i = 0; i < usedVertices.size(); ++i)
+            result->mColors[c][i] = mesh->mColors[c][meshVertices[usedVertices[i]]];
+    }
+
+    result->mNumFaces = numFaces;
+    result->mFaces = new aiFace[numFaces];
+    aiFace * face = result->mFaces;
+    for (unsigned int f = 0; f < removedFaces.size(); ++f)
+    {
+        if (removedFaces[f]) continue;
+        face->mNumIndices = 3;
+        face->mIndices = new unsigned int[3];
+        for (unsigned int k = 0; k < 3; ++k)
+            face->mIndices[k] = indices[faces[f * 3 + k]];
+        ++face;
+    }
+    return result;
+}
+
+aiMesh * urdf2inventor::simplifyMesh(const aiMesh * mesh, unsigned int targetFaces)
+{
+    if (!mesh || (mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE) || (mesh->mNumFaces <= targetFaces))
+        return NULL;
+    QuadricSimplifier simplifier(mesh);
+    simplifier.simplify(targetFaces);
+    return simplifier.getMesh();
+}
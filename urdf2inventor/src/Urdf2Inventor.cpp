@@ -205,6 +205,9 @@ Urdf2Inventor::ConversionResultPtr Urdf2Inventor::convert(const ConversionParame
     {
         mParams.reset(new MeshConvertRecursionParamsT(scaleFactor, params->material,
                                         OUTPUT_EXTENSION, params->addVisualTransform));
+        mParams->numThreads = params->numThreads;
+        mParams->meshCache = meshCache;
+        mParams->meshOptions = params->meshOptions;
     }
 
     if (!urdf2inventor::convertMeshes<MeshFormat>(*urdf_traverser, params->rootLinkName, mParams))
@@ -264,13 +267,7 @@ void Urdf2Inventor::cleanup()
 
 bool Urdf2Inventor::writeInventorFile(SoNode * node, const std::string& filename)
 {
-    SoOutput out;
-    if (!out.openFile(filename.c_str())) return false;
-    out.setBinary(false);
-    SoWriteAction write(&out);
-    write.apply(node);
-    write.getOutput()->closeFile();
-    return true;
+    return urdf2inventor::writeInventorFile(node, filename, meshOptions.binaryOutput);
 }
 
 
@@ -366,7 +363,8 @@ void Urdf2Inventor::addLocalAxes(const LinkConstPtr& link, SoSeparator * addToNo
 SoNode * Urdf2Inventor::getAsInventor(const LinkPtr& from_link, bool useScaleFactor,
                                       bool _addAxes, float _axesRadius, float _axesLength,
                                       const EigenTransform& addVisualTransform,
-                                      std::set<std::string> * textureFiles
+                                      std::set<std::string> * textureFiles,
+                                      SharedMeshNodes& sharedMeshes
                                      )
 {
     if (!from_link.get())
@@ -382,7 +380,10 @@ SoNode * Urdf2Inventor::getAsInventor(const LinkPtr& from_link, bool useScaleFac
                                         useScaleFactor ? scaleFactor : 1.0,
                                         addVisualTransform,
                                         useVisuals,
-                                        useScaleFactor);
+                                        useScaleFactor,
+                                        meshOptions,
+                                        meshCache,
+                                        &sharedMeshes);
     if (!allVisuals)
     {
         ROS_ERROR("Could not get visuals");
@@ -422,7 +423,8 @@ SoNode * Urdf2Inventor::getAsInventor(const LinkPtr& from_link, bool useScaleFac
             return NULL;
         }
         SoNode * childNode = getAsInventor(childLink, useScaleFactor,
-                                           _addAxes, _axesRadius, _axesLength, addVisualTransform, textureFiles);
+                                           _addAxes, _axesRadius, _axesLength, addVisualTransform, textureFiles,
+                                           sharedMeshes);
         if (!childNode)
         {
             ROS_ERROR_STREAM("Could not get child node for " << childLink->name);
@@ -458,8 +460,9 @@ SoNode * Urdf2Inventor::getAsInventor(const std::string& fromLink, bool useScale
         ROS_ERROR_STREAM("No link named '" << startLink << "'");
         return NULL;
     }
+    SharedMeshNodes sharedMeshes;
     SoNode * root = getAsInventor(startLink, useScaleFactor, _addAxes, _axesRadius, _axesLength,
-                                  addVisualTransform, textureFiles);
+                                  addVisualTransform, textureFiles, sharedMeshes);
     urdf2inventor::removeTextureCopies(root);
     return root;
 }
@@ -494,29 +497,24 @@ bool Urdf2Inventor::writeAsInventor(const std::string& ivFilename, const LinkPtr
     ROS_INFO("Converting model...");
 
     std::set<std::string> textureFiles;
+    SharedMeshNodes sharedMeshes;
     SoNode * inv = getAsInventor(from_link, useScaleFactor, _addAxes, _axesRadius, _axesLength,
-                                 addVisualTransform, &textureFiles);
+                                 addVisualTransform, &textureFiles, sharedMeshes);
     if (!inv)
     {
         ROS_ERROR("could not generate overall inventor file");
         return false;
     }
 
-    // get the node to IV XML format
-    std::string resultFileContent;
-    if (!urdf2inventor::writeInventorFileString(inv, resultFileContent))
-    {
-        ROS_ERROR("Could not get the mesh file content");
-        return false;
-    }
-
     // handle textures: adjust file references, if required.
+    // The references are changed in the scene graph, so that it can be written directly to the file.
     if (!textureFiles.empty())
     {
 
         // get common parent path of all textures
+        urdf_traverser::helpers::PathTable pathTable;
         std::string commonParent;
-        if (!urdf_traverser::helpers::getCommonParentPath(textureFiles, commonParent))
+        if (!pathTable.getCommonParentPath(textureFiles, commonParent))
         {
             ROS_ERROR_STREAM("Could not find common parent path of all files");
             return false;
@@ -530,21 +528,23 @@ bool Urdf2Inventor::writeAsInventor(const std::string& ivFilename, const LinkPtr
         // ROS_INFO_STREAM("Directory name: "<<fileDir);
 
         std::map<std::string, std::set<std::string> > texToCopy;
+        std::map<std::string, std::string> newReferences;
 
         ROS_INFO("Fixing texture file references...");
-        if (!urdf2inventor::helpers::fixFileReferences(
+        if (!urdf2inventor::helpers::getFileReferences(
                     fileDir,
                     fileDir + TEX_OUTPUT_DIRECTORY_NAME,
                     commonParent,
                     textureFiles,
-                    resultFileContent, texToCopy))
+                    newReferences, texToCopy, &pathTable))
         {
             ROS_ERROR("Could not fix texture references");
             return false;
         }
+        urdf2inventor::setTexturePaths(inv, newReferences);
 
         ROS_INFO("Copying texture files...");
-        if (!urdf2inventor::helpers::writeFiles(texToCopy, fileDir))
+        if (!urdf2inventor::helpers::writeFiles(texToCopy, fileDir, meshOptions.textureInstall))
         {
             ROS_ERROR("Could not write textures");
             return false;
@@ -553,8 +553,8 @@ bool Urdf2Inventor::writeAsInventor(const std::string& ivFilename, const LinkPtr
 
     ROS_INFO("Writing model...");
 
-    // write content to file
-    if (!urdf_traverser::helpers::writeToFile(resultFileContent, ivFilename))
+    // write the node directly to the file
+    if (!writeInventorFile(inv, ivFilename))
     {
         ROS_ERROR_STREAM("Could not write file " << ivFilename);
         return false;
@@ -37,6 +37,7 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <algorithm>
 
 int main(int argc, char** argv)
 {
@@ -91,12 +92,84 @@ int main(int argc, char** argv)
 
     urdf2inventor::Urdf2Inventor converter(traverser, scaleFactor);
 
+    // Cache for converted meshes, so that meshes used by several links are only converted once.
+    // If a cache directory is given, the converted meshes are kept there for subsequent runs.
+    bool useMeshCache = false;
+    priv.param<bool>("mesh_cache", useMeshCache, useMeshCache);
+    ROS_INFO("mesh_cache: <%i>", useMeshCache);
+    std::string meshCacheDir;
+    priv.param<std::string>("mesh_cache_dir", meshCacheDir, meshCacheDir);
+    ROS_INFO("mesh_cache_dir: <%s>", meshCacheDir.c_str());
+    if (useMeshCache || !meshCacheDir.empty())
+    {
+        converter.setMeshCache(urdf2inventor::MeshCachePtr(new urdf2inventor::MeshCache(meshCacheDir)));
+    }
+
     ROS_INFO("Starting model conversion...");
 
     std::string outputMaterial = "plastic";  // output material does not really matter for only conversion to IV
     urdf2inventor::Urdf2Inventor::ConversionParametersPtr params
         = converter.getBasicConversionParams(rootLinkName, outputMaterial, addTrans);
 
+    // number of threads to convert the meshes with, 0 for the number of hardware threads
+    int numThreads = 1;
+    priv.param<int>("num_threads", numThreads, numThreads);
+    ROS_INFO("num_threads: <%i>", numThreads);
+    params->numThreads = std::max(0, numThreads);
+
+    // Shape node to convert triangle meshes to: "strips" (SoIndexedTriangleStripSet) or "faces" (SoIndexedFaceSet)
+    std::string triangleShape = "strips";
+    priv.param<std::string>("triangle_shape", triangleShape, triangleShape);
+    ROS_INFO("triangle_shape: <%s>", triangleShape.c_str());
+    if (triangleShape == "faces")
+    {
+        params->meshOptions.triangleShape = urdf2inventor::MeshConversionOptions::FACE_SET;
+    }
+    else if (triangleShape != "strips")
+    {
+        ROS_ERROR("Unknown triangle_shape '%s', has to be 'strips' or 'faces'", triangleShape.c_str());
+        return 0;
+    }
+    // join identical vertices of the meshes, so that triangles share vertices
+    priv.param<bool>("join_identical_vertices", params->meshOptions.joinIdenticalVertices,
+                     params->meshOptions.joinIdenticalVertices);
+    ROS_INFO("join_identical_vertices: <%i>", params->meshOptions.joinIdenticalVertices);
+    // Preset of post-processing steps applied to the meshes when importing them:
+    // "none", "fast", "render-optimized" or "collision-minimal" (see urdf2inventor::MeshConversionOptions)
+    std::string postProcessing = "fast";
+    priv.param<std::string>("mesh_postprocessing", postProcessing, postProcessing);
+    ROS_INFO("mesh_postprocessing: <%s>", postProcessing.c_str());
+    if (!urdf2inventor::MeshConversionOptions::getPostProcessing(postProcessing, params->meshOptions.postProcessing))
+    {
+        ROS_ERROR("Unknown mesh_postprocessing preset '%s'", postProcessing.c_str());
+        return 0;
+    }
+    // Ratios of the number of triangles of the meshes for lower levels of detail, e.g. [0.25, 0.05],
+    // and the distances from the viewer beyond which they are displayed.
+    priv.param<std::vector<float> >("lod_ratios", params->meshOptions.lodRatios, params->meshOptions.lodRatios);
+    priv.param<std::vector<float> >("lod_ranges", params->meshOptions.lodRanges, params->meshOptions.lodRanges);
+    ROS_INFO("lod_ratios: %lu levels", params->meshOptions.lodRatios.size());
+    // write the meshes and the whole robot in the binary inventor format
+    priv.param<bool>("binary_output", params->meshOptions.binaryOutput, params->meshOptions.binaryOutput);
+    ROS_INFO("binary_output: <%i>", params->meshOptions.binaryOutput);
+    // How to install the textures: "copy", "hardlink", "symlink" or "reflink" (see urdf2inventor::MeshConversionOptions)
+    std::string textureInstall = "copy";
+    priv.param<std::string>("texture_install", textureInstall, textureInstall);
+    ROS_INFO("texture_install: <%s>", textureInstall.c_str());
+    if (!urdf2inventor::MeshConversionOptions::getTextureInstall(textureInstall, params->meshOptions.textureInstall))
+    {
+        ROS_ERROR("Unknown texture_install '%s'", textureInstall.c_str());
+        return 0;
+    }
+    // Directory to extract compressed textures embedded in the meshes to. Cached meshes
+    // reference these files, so by default they are kept in the mesh cache directory.
+    std::string embeddedTextureDir;
+    priv.param<std::string>("embedded_texture_dir", embeddedTextureDir, embeddedTextureDir);
+    if (embeddedTextureDir.empty() && !meshCacheDir.empty()) embeddedTextureDir = meshCacheDir + "/textures";
+    ROS_INFO("embedded_texture_dir: <%s>", embeddedTextureDir.c_str());
+    params->meshOptions.embeddedTextureDir = embeddedTextureDir;
+    converter.setMeshConversionOptions(params->meshOptions);
+
     ROS_INFO("Loading and converting...");
 
     urdf2inventor::Urdf2Inventor::ConversionResultPtr cResult =
@@ -110,6 +183,7 @@ int main(int argc, char** argv)
     ROS_INFO("Conversion done. Now writing files.");
 
     urdf2inventor::FileIO<urdf2inventor::Urdf2Inventor::MeshFormat> fileIO(outputDir);
+    fileIO.setTextureInstall(params->meshOptions.textureInstall);
     if (!fileIO.write(cResult))
     {
         ROS_ERROR("Could not write files");
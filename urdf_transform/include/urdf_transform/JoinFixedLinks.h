@@ -43,7 +43,8 @@ namespace urdf_transform
 /**
  * Recursively removes all fixed links down the chain in the model by adding
  * visuals and collision geometry to the first parent link which is
- * attached to a non-fixed link.
+ * attached to a non-fixed link. The inertials of the removed links are
+ * combined with the inertial of this parent link.
  */
 bool joinFixedLinks(urdf_traverser::UrdfTraverser& traverser, const std::string& fromLink);
 }
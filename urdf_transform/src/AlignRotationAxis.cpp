@@ -148,6 +148,8 @@ bool urdf_transform::allRotationsToAxis(UrdfTraverser& traverser, const std::str
     // operates on the links parent joints.
     int travRet = traverser.traverseTreeTopDown(startLink,
                   boost::bind(&allRotationsToAxisCB, _1), p, false);
+    // joint origins have changed
+    traverser.invalidateTopology();
     if (travRet <= 0)
     {
         ROS_ERROR("Recursion to align all rotation axes failed");
@@ -38,6 +38,74 @@ using urdf_traverser::UrdfTraverser;
 using urdf_traverser::RecursionParams;
 using urdf_traverser::LinkRecursionParams;
 
+/**
+ * Gets the inertia tensor of \e inertial, about its center of mass, in the frame given by \e trans
+ * (the transform from the link frame in which the inertial is to be expressed to the link frame of the inertial)
+ * \param com the center of mass in the frame of \e trans
+ */
+Eigen::Matrix3d getInertia(const urdf_traverser::InertialPtr& inertial, const urdf_traverser::EigenTransform& trans,
+                           Eigen::Vector3d& com)
+{
+    Eigen::Matrix3d inertia;
+    inertia << inertial->ixx, inertial->ixy, inertial->ixz,
+               inertial->ixy, inertial->iyy, inertial->iyz,
+               inertial->ixz, inertial->iyz, inertial->izz;
+    urdf_traverser::EigenTransform inertialTrans = trans * urdf_traverser::getTransform(inertial->origin);
+    com = inertialTrans.translation();
+    Eigen::Matrix3d rot = inertialTrans.linear();
+    return rot * inertia * rot.transpose();
+}
+
+/**
+ * Joins the inertial of \e link into the inertial of its parent \e parentLink, where \e localTrans
+ * is the transform from \e parentLink to \e link. The combined center of mass is the mass-weighted
+ * mean of both, and the inertia tensors are rotated into the parent frame and shifted to the combined
+ * center of mass with the parallel axis theorem. The orientation of the parent's inertial frame is kept.
+ */
+void joinInertial(urdf_traverser::LinkPtr& parentLink, const urdf_traverser::LinkPtr& link,
+                  const urdf_traverser::EigenTransform& localTrans)
+{
+    if (!link->inertial) return;
+    if (!parentLink->inertial)
+    {
+        parentLink->inertial.reset(new urdf::Inertial());
+    }
+    urdf_traverser::InertialPtr parentInertial = parentLink->inertial;
+
+    Eigen::Vector3d parentCom, childCom;
+    Eigen::Matrix3d parentInertia = getInertia(parentInertial, urdf_traverser::EigenTransform::Identity(), parentCom);
+    Eigen::Matrix3d childInertia = getInertia(link->inertial, localTrans, childCom);
+    double parentMass = parentInertial->mass;
+    double childMass = link->inertial->mass;
+    double mass = parentMass + childMass;
+
+    Eigen::Vector3d com = parentCom;
+    if (mass > 0) com = (parentMass * parentCom + childMass * childCom) / mass;
+
+    // parallel axis theorem: shift each inertia tensor from its own center of mass to the combined one
+    Eigen::Vector3d parentOffset = parentCom - com;
+    Eigen::Vector3d childOffset = childCom - com;
+    Eigen::Matrix3d inertia = parentInertia + childInertia
+        + parentMass * (parentOffset.squaredNorm() * Eigen::Matrix3d::Identity() - parentOffset * parentOffset.transpose())
+        + childMass * (childOffset.squaredNorm() * Eigen::Matrix3d::Identity() - childOffset * childOffset.transpose());
+
+    // express the combined inertia in the orientation of the parent's inertial frame
+    urdf_traverser::EigenTransform inertialTrans = urdf_traverser::getTransform(parentInertial->origin);
+    Eigen::Matrix3d rot = inertialTrans.linear();
+    inertia = rot.transpose() * inertia * rot;
+    inertialTrans.translation() = com;
+    urdf_traverser::setTransform(inertialTrans, parentInertial->origin);
+
+    parentInertial->mass = mass;
+    parentInertial->ixx = inertia(0, 0);
+    parentInertial->iyy = inertia(1, 1);
+    parentInertial->izz = inertia(2, 2);
+    // average the off-diagonal elements, which can differ slightly due to rounding
+    parentInertial->ixy = 0.5 * (inertia(0, 1) + inertia(1, 0));
+    parentInertial->ixz = 0.5 * (inertia(0, 2) + inertia(2, 0));
+    parentInertial->iyz = 0.5 * (inertia(1, 2) + inertia(2, 1));
+}
+
 /**
  * Callback: If the parent joint of this link is fixed, it will be removed,
  * and this link's visual will be connected to the parent link.
@@ -45,21 +113,13 @@ using urdf_traverser::LinkRecursionParams;
  * Otherwise, it returns the pointer to the parent link which now contains
  * this link's visual/collision.
  */
-int joinFixedLinksOnThis(urdf_traverser::RecursionParamsPtr& params)
+int joinFixedLinksOnThis(LinkRecursionParams& lparam)
 {
-    LinkRecursionParams::Ptr lparam =
-      baselib_binding_ns::dynamic_pointer_cast<LinkRecursionParams>(params);
-    if (!lparam)
-    {
-        ROS_ERROR("Wrong recursion parameter type");
-        return -1;
-    }
-
-    urdf_traverser::LinkPtr link = lparam->getLink();
+    urdf_traverser::LinkPtr link = lparam.getLink();
 
     if (!link)
     {
-        lparam->resultLink = link;
+        lparam.resultLink = link;
         return 1;
     }
 
@@ -68,16 +128,16 @@ int joinFixedLinksOnThis(urdf_traverser::RecursionParamsPtr& params)
     if (!jointToParent)
     {
         // ROS_WARN("End of chain at %s, because of no parent joint", link->name.c_str());
-        lparam->resultLink = link;
+        lparam.resultLink = link;
         return 1;
     }
 
     urdf_traverser::LinkPtr parentLink;
-    lparam->model->getLink(jointToParent->parent_link_name, parentLink);
+    lparam.model->getLink(jointToParent->parent_link_name, parentLink);
     if (!parentLink)
     {
         // ROS_WARN("End of chain at %s, because of no parent link", link->name.c_str());
-        lparam->resultLink = link;
+        lparam.resultLink = link;
         return 1;
     }
 
@@ -93,7 +153,7 @@ int joinFixedLinksOnThis(urdf_traverser::RecursionParamsPtr& params)
         // We won't delete this joint, as it is active.
         /*ROS_INFO("No joining of %s and %s (return latter)",
                  parentLink->name.c_str(),link->name.c_str());*/
-        lparam->resultLink = link;
+        lparam.resultLink = link;
         return 1;
     }
 
@@ -160,7 +220,7 @@ int joinFixedLinksOnThis(urdf_traverser::RecursionParamsPtr& params)
 
         // this link's child link has to be added to parents as well
         urdf_traverser::LinkPtr childChildLink;
-        lparam->model->getLink(child->child_link_name, childChildLink);
+        lparam.model->getLink(child->child_link_name, childChildLink);
         if (!childChildLink)
         {
             ROS_ERROR("consistency: found null child link for joint %s", child->name.c_str());
@@ -198,11 +258,11 @@ int joinFixedLinksOnThis(urdf_traverser::RecursionParamsPtr& params)
 
 
     // combine inertials
-    // parent->inertial=XXX TODO;
-        
+    joinInertial(parentLink, link, localTrans);
+
     // ROS_INFO("Resulting link: %s",parentLink->name.c_str());
 
-    lparam->resultLink = parentLink;
+    lparam.resultLink = parentLink;
     return 1;
 }
 
@@ -225,18 +285,15 @@ bool urdf_transform::joinFixedLinks(UrdfTraverser& traverser, const std::string&
     // ROS_INFO_STREAM("### Joining fixed links starting from "<<startLink);
 
     bool includeRoot = false;
-    LinkRecursionParams * lp = new LinkRecursionParams(traverser.getModel());
-    urdf_traverser::RecursionParamsPtr p(lp);
-    int travResult = traverser.traverseTreeBottomUp(startLink,
-                                                    boost::bind(&joinFixedLinksOnThis, _1),
-                                                    p, includeRoot);
+    LinkRecursionParams lp(traverser.getModel());
+    int travResult = traverser.traverse(startLink, joinFixedLinksOnThis, lp, includeRoot, true);
     if (travResult < 0)
     {
         ROS_ERROR("Could not join fixed links");
         return false;
     }
 
-    urdf_traverser::LinkPtr newLink = lp->resultLink;
+    urdf_traverser::LinkPtr newLink = lp.resultLink;
     if (includeRoot && (newLink->name != startLink))
     {
         ROS_INFO_STREAM("Starting link " << startLink << " re-assigned to be " << newLink->name << ".");
@@ -244,6 +301,7 @@ bool urdf_transform::joinFixedLinks(UrdfTraverser& traverser, const std::string&
         {
             ROS_INFO("Re-assigning root link of the model");
             traverser.getModel()->root_link_ = newLink;
+            traverser.invalidateTopology();
         }
     }
 
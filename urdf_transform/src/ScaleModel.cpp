@@ -38,27 +38,19 @@ using urdf_traverser::UrdfTraverser;
 /**
  * Function used for recursion by scaleModel().
  */
-int scaleModelFunc(urdf_traverser::RecursionParamsPtr& p)
+int scaleModelFunc(urdf_traverser::FactorRecursionParams& param)
 {
-    urdf_traverser::FactorRecursionParamsPtr param =
-        baselib_binding_ns::dynamic_pointer_cast<urdf_traverser::FactorRecursionParams>(p);
-    if (!param)
-    {
-        ROS_ERROR("Wrong recursion parameter type");
-        return -1;
-    }
-
-    urdf_traverser::LinkPtr link = param->getLink();
+    urdf_traverser::LinkPtr link = param.getLink();
     if (!link)
     {
         ROS_ERROR("Recursion parameter must have initialised link!");
         return -1;
     }
-    urdf_traverser::scaleTranslation(link, param->factor);
+    urdf_traverser::scaleTranslation(link, param.factor);
     urdf_traverser::JointPtr pjoint = link->parent_joint;
     if (pjoint)
     {
-        urdf_traverser::scaleTranslation(pjoint, param->factor);
+        urdf_traverser::scaleTranslation(pjoint, param.factor);
     }
     return 1;
 }
@@ -66,8 +58,11 @@ int scaleModelFunc(urdf_traverser::RecursionParamsPtr& p)
 bool urdf_transform::scaleModel(UrdfTraverser& traverser, const std::string& fromLink, double scale_factor)
 {
     // do one call of scaleModel(RecursionParams) for the root link
-    urdf_traverser::RecursionParamsPtr p(new urdf_traverser::FactorRecursionParams(scale_factor));
-    return traverser.traverseTreeTopDown(fromLink, boost::bind(&scaleModelFunc, _1), p, true) == 1;
+    urdf_traverser::FactorRecursionParams p(scale_factor);
+    int travRet = traverser.traverse(fromLink, scaleModelFunc, p, true);
+    // joint origins have changed
+    traverser.invalidateTopology();
+    return travRet == 1;
 }
 
 bool urdf_transform::scaleModel(UrdfTraverser& traverser, double scale_factor)
@@ -0,0 +1,193 @@
+/**
+ * <ORGANIZATION> = Jennifer Buehler
+ * <COPYRIGHT HOLDER> = Jennifer Buehler
+ *
+ * Copyright (c) 2016 Jennifer Buehler
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <ORGANIZATION> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ------------------------------------------------------------------------------
+ **/
+#include <gtest/gtest.h>
+#include <urdf_traverser/UrdfTraverser.h>
+#include <urdf_traverser/Snapshot.h>
+#include <urdf_transform/JoinFixedLinks.h>
+
+#include <cmath>
+#include <string>
+
+using urdf_traverser::UrdfTraverser;
+using urdf_traverser::LinkPtr;
+
+namespace
+{
+
+// Two fixed joints in a row, which are joined into "base", followed by a revolute joint.
+const char* const JOIN_TEST_URDF =
+    "<robot name=\"test\">"
+    "  <link name=\"base\"/>"
+    "  <link name=\"plate\">"
+    "    <visual><geometry><box size=\"1 2 3\"/></geometry></visual>"
+    "  </link>"
+    "  <link name=\"mount\"/>"
+    "  <link name=\"arm\"/>"
+    "  <joint name=\"base_plate\" type=\"fixed\">"
+    "    <parent link=\"base\"/><child link=\"plate\"/><origin xyz=\"0 0 1\"/>"
+    "  </joint>"
+    "  <joint name=\"plate_mount\" type=\"fixed\">"
+    "    <parent link=\"plate\"/><child link=\"mount\"/><origin xyz=\"0 2 0\"/>"
+    "  </joint>"
+    "  <joint name=\"mount_arm\" type=\"revolute\">"
+    "    <parent link=\"mount\"/><child link=\"arm\"/><origin xyz=\"3 0 0\"/><axis xyz=\"0 0 1\"/>"
+    "    <limit lower=\"-1\" upper=\"1\" effort=\"1\" velocity=\"1\"/>"
+    "  </joint>"
+    "</robot>";
+
+// "base" and "plate" have inertials with rotated frames, "mount" has none, and the
+// inertial of "tool" is joined into "arm", which has none.
+const char* const INERTIAL_TEST_URDF =
+    "<robot name=\"test\">"
+    "  <link name=\"base\">"
+    "    <inertial><origin xyz=\"0.1 0 0\" rpy=\"0 0 1.5707963267948966\"/><mass value=\"2\"/>"
+    "    <inertia ixx=\"1\" ixy=\"0\" ixz=\"0\" iyy=\"2\" iyz=\"0\" izz=\"3\"/></inertial>"
+    "  </link>"
+    "  <link name=\"plate\">"
+    "    <inertial><origin xyz=\"0 1 0\"/><mass value=\"1\"/>"
+    "    <inertia ixx=\"4\" ixy=\"0\" ixz=\"0\" iyy=\"5\" iyz=\"0\" izz=\"6\"/></inertial>"
+    "  </link>"
+    "  <link name=\"mount\"/>"
+    "  <link name=\"arm\"/>"
+    "  <link name=\"tool\">"
+    "    <inertial><origin xyz=\"1 0 0\"/><mass value=\"0.5\"/>"
+    "    <inertia ixx=\"1\" ixy=\"0.1\" ixz=\"0\" iyy=\"2\" iyz=\"0\" izz=\"3\"/></inertial>"
+    "  </link>"
+    "  <joint name=\"base_plate\" type=\"fixed\">"
+    "    <parent link=\"base\"/><child link=\"plate\"/><origin xyz=\"0 0 1\" rpy=\"1.5707963267948966 0 0\"/>"
+    "  </joint>"
+    "  <joint name=\"plate_mount\" type=\"fixed\">"
+    "    <parent link=\"plate\"/><child link=\"mount\"/><origin xyz=\"0 2 0\"/>"
+    "  </joint>"
+    "  <joint name=\"mount_arm\" type=\"revolute\">"
+    "    <parent link=\"mount\"/><child link=\"arm\"/><origin xyz=\"3 0 0\"/><axis xyz=\"0 0 1\"/>"
+    "    <limit lower=\"-1\" upper=\"1\" effort=\"1\" velocity=\"1\"/>"
+    "  </joint>"
+    "  <joint name=\"arm_tool\" type=\"fixed\">"
+    "    <parent link=\"arm\"/><child link=\"tool\"/><origin xyz=\"0 0 0.5\" rpy=\"0 0 1.5707963267948966\"/>"
+    "  </joint>"
+    "</robot>";
+
+/**
+ * Expects that \e arm has been re-linked to \e base by joining the fixed links in between.
+ */
+void expectJoined(urdf::Model& model)
+{
+    LinkPtr base = model.links_["base"];
+    LinkPtr arm = model.links_["arm"];
+    ASSERT_TRUE(base && arm);
+    ASSERT_TRUE(arm->getParent());
+    EXPECT_EQ("base", arm->getParent()->name);
+    ASSERT_EQ(1u, base->child_joints.size());
+    ASSERT_EQ(1u, base->child_links.size());
+    EXPECT_EQ("mount_arm", base->child_joints[0]->name);
+    EXPECT_EQ("base", base->child_joints[0]->parent_link_name);
+    EXPECT_EQ("arm", base->child_links[0]->name);
+    const urdf::Vector3& position = base->child_joints[0]->parent_to_joint_origin_transform.position;
+    EXPECT_DOUBLE_EQ(3, position.x);
+    EXPECT_DOUBLE_EQ(2, position.y);
+    EXPECT_DOUBLE_EQ(1, position.z);
+}
+
+}  // namespace
+
+TEST(JoinFixedLinksTest, SnapshotRoundTrip)
+{
+    UrdfTraverser traverser;
+    ASSERT_TRUE(traverser.loadModelFromXMLString(JOIN_TEST_URDF));
+    ASSERT_TRUE(urdf_transform::joinFixedLinks(traverser, ""));
+    urdf_traverser::ModelPtr model = traverser.getModel();
+    expectJoined(*model);
+    EXPECT_EQ(1u, model->links_["base"]->visual_array.size());
+
+    // the joined links are still in the model, but not in the tree any more
+    std::string buffer;
+    ASSERT_TRUE(urdf_traverser::writeSnapshot(*model, "", buffer));
+    UrdfTraverser loaded;
+    std::string modelDir;
+    ASSERT_TRUE(urdf_traverser::readSnapshot(buffer, *loaded.getModel(), modelDir));
+    expectJoined(*loaded.getModel());
+    EXPECT_TRUE(loaded.getModel()->links_["plate"]->child_joints.empty());
+    EXPECT_TRUE(loaded.getModel()->links_["mount"]->child_joints.empty());
+}
+
+TEST(JoinFixedLinksTest, JoinInertials)
+{
+    UrdfTraverser traverser;
+    ASSERT_TRUE(traverser.loadModelFromXMLString(INERTIAL_TEST_URDF));
+    ASSERT_TRUE(urdf_transform::joinFixedLinks(traverser, ""));
+    urdf_traverser::ModelPtr model = traverser.getModel();
+    const double tolerance = 1e-12;
+
+    // In the frame of "base", the inertial of "base" is diag(2, 1, 3) at (0.1, 0, 0) and the one of
+    // "plate" diag(4, 6, 5) at (0, 0, 2). The combined center of mass is at (0.2 / 3, 0, 2 / 3), and the
+    // parallel axis terms are m * (|d|^2 * I - d * d^T) with the offsets d = (0.1 / 3, 0, -2 / 3) and
+    // (-0.2 / 3, 0, 4 / 3): xx = 24 / 9, yy = 24.06 / 9, zz = 0.06 / 9 and xz = 1.2 / 9 in total.
+    // The result is expressed in the frame of the inertial of "base", which is rotated by 90 degrees
+    // about z, so x and y are swapped and xz becomes -yz.
+    urdf_traverser::InertialPtr inertial = model->links_["base"]->inertial;
+    ASSERT_TRUE(inertial);
+    EXPECT_NEAR(3, inertial->mass, tolerance);
+    EXPECT_NEAR(0.2 / 3, inertial->origin.position.x, tolerance);
+    EXPECT_NEAR(0, inertial->origin.position.y, tolerance);
+    EXPECT_NEAR(2.0 / 3, inertial->origin.position.z, tolerance);
+    double roll, pitch, yaw;
+    inertial->origin.rotation.getRPY(roll, pitch, yaw);
+    EXPECT_NEAR(0, roll, tolerance);
+    EXPECT_NEAR(0, pitch, tolerance);
+    EXPECT_NEAR(M_PI / 2, yaw, tolerance);
+    EXPECT_NEAR(1 + 6 + 24.06 / 9, inertial->ixx, tolerance);
+    EXPECT_NEAR(2 + 4 + 24.0 / 9, inertial->iyy, tolerance);
+    EXPECT_NEAR(3 + 5 + 0.06 / 9, inertial->izz, tolerance);
+    EXPECT_NEAR(0, inertial->ixy, tolerance);
+    EXPECT_NEAR(0, inertial->ixz, tolerance);
+    EXPECT_NEAR(-1.2 / 9, inertial->iyz, tolerance);
+
+    // "arm" gets the inertial of "tool", moved to (0, 1, 0.5) and rotated by 90 degrees about z
+    inertial = model->links_["arm"]->inertial;
+    ASSERT_TRUE(inertial);
+    EXPECT_NEAR(0.5, inertial->mass, tolerance);
+    EXPECT_NEAR(0, inertial->origin.position.x, tolerance);
+    EXPECT_NEAR(1, inertial->origin.position.y, tolerance);
+    EXPECT_NEAR(0.5, inertial->origin.position.z, tolerance);
+    EXPECT_NEAR(2, inertial->ixx, tolerance);
+    EXPECT_NEAR(1, inertial->iyy, tolerance);
+    EXPECT_NEAR(3, inertial->izz, tolerance);
+    EXPECT_NEAR(-0.1, inertial->ixy, tolerance);
+    EXPECT_NEAR(0, inertial->ixz, tolerance);
+    EXPECT_NEAR(0, inertial->iyz, tolerance);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
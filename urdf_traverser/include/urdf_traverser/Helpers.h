@@ -39,6 +39,7 @@
  */
 
 #include <iostream>
+#include <map>
 #include <string>
 #include <set>
 
@@ -151,7 +152,19 @@ extern std::string getDirectoryName(const std::string& path);
  */
 extern std::string replaceAll(const std::string& text, const std::string& from, const std::string& to);
 
+/**
+ * Replaces all occurrences of the keys of \e replacements in the string \e text with their values,
+ * in one pass over \e text (with an Aho-Corasick automaton of the keys). Where several keys
+ * match, the one which starts first, and of those the longest, is replaced. Replaced text
+ * is not searched again.
+ */
+extern std::string replaceAll(const std::string& text, const std::map<std::string, std::string>& replacements);
+
 extern bool writeToFile(const std::string& content, const std::string& filename);
+/**
+ * Reads the whole file into \e content (replacing it) with a single read of the file size.
+ */
+extern bool readFromFile(const std::string& filename, std::string& content);
 extern void deleteFile(const char* file);
 
 extern void findAndReplace(const std::string& newStr, const std::string& oldStr, const std::string& in, std::string& out);
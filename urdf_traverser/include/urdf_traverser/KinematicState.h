@@ -0,0 +1,373 @@
+/**
+ * <ORGANIZATION> = Jennifer Buehler
+ * <COPYRIGHT HOLDER> = Jennifer Buehler
+ *
+ * Copyright (c) 2016 Jennifer Buehler
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <ORGANIZATION> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ------------------------------------------------------------------------------
+ **/
+#ifndef URDF_TRAVERSER_KINEMATICSTATE_H
+#define URDF_TRAVERSER_KINEMATICSTATE_H
+// Copyright Jennifer Buehler
+
+#include <urdf_traverser/Types.h>
+#include <baselib_binding/SharedPtr.h>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/StdVector>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace urdf_traverser
+{
+class UrdfTraverser;
+
+/**
+ * \brief Link transforms for a batch of joint configurations, as computed by
+ * KinematicState::computeLinkTransforms().
+ *
+ * The transforms are stored in structure-of-arrays layout, in blocks of BLOCK_SIZE
+ * configurations: block b holds configurations b * BLOCK_SIZE to (b + 1) * BLOCK_SIZE - 1
+ * (one per row) in the getNumLinks() * NUM_ELEMENTS consecutive columns of getData() starting
+ * at getBlock(b). Each link has NUM_ELEMENTS consecutive columns in a block, the rotation
+ * matrix (row-major) followed by the translation. Rows of the last block beyond
+ * getNumConfigurations() are unused.
+ */
+class LinkTransformBatch
+{
+public:
+    // number of columns per link
+    static const unsigned int NUM_ELEMENTS;
+    // number of configurations per block, i.e. rows of getData()
+    static const unsigned int BLOCK_SIZE = 32;
+
+    LinkTransformBatch():
+        numConfigurations(0),
+        numLinks(0) {}
+
+    unsigned int getNumConfigurations() const
+    {
+        return numConfigurations;
+    }
+
+    unsigned int getNumLinks() const
+    {
+        return numLinks;
+    }
+
+    unsigned int getBlockSize() const
+    {
+        return data.rows();
+    }
+
+    /**
+     * Returns the first column of block \e b in getData()
+     */
+    unsigned int getBlock(unsigned int b) const
+    {
+        return b * numLinks * NUM_ELEMENTS;
+    }
+
+    /**
+     * Returns the transform of the link (index as in KinematicState::getLinkNames())
+     * for configuration \e config.
+     */
+    EigenTransform getTransform(unsigned int config, unsigned int linkIndex) const;
+
+    const Eigen::ArrayXXd& getData() const
+    {
+        return data;
+    }
+
+private:
+    friend class KinematicState;
+    Eigen::ArrayXXd data;
+    unsigned int numConfigurations;
+    unsigned int numLinks;
+};
+
+/**
+ * \brief Forward kinematics of a URDF model for a given set of joint positions.
+ *
+ * When initialized, the joints of the model (starting from a given link, which
+ * becomes the base of all link transforms) are brought into dependency order with
+ * urdf_traverser::getDependencyOrderedJoints(), and the joint origins and axes are
+ * read once. Setting the joint positions then computes the transforms of all links in
+ * one pass over the joints and stores them in a contiguous array, so that transforms
+ * between links can afterwards be queried without walking the joint chains.
+ *
+ * Changing joint positions only marks the joints as changed. The transforms are
+ * recomputed at the next query, and only for the links below the changed joints:
+ * in dependency order, the joints below a joint directly follow it.
+ *
+ * Revolute, continuous and prismatic joints move around/along the joint axis. All other
+ * joint types are treated as fixed joints. The degrees of freedom are the active
+ * joints (see urdf_traverser::isActive()) in dependency order, see getJointNames().
+ *
+ * If the model is changed, the state has to be initialized again.
+ *
+ * As the link transforms are computed lazily, all methods returning them update the
+ * state and are therefore not const. The const methods, like computeLinkTransforms()
+ * and computeJacobians(), don't modify the state and can be called from several threads
+ * at once, as long as no other thread modifies it.
+ *
+ * \author Jennifer Buehler
+ */
+class KinematicState
+{
+public:
+    typedef baselib_binding::shared_ptr<KinematicState>::type Ptr;
+    typedef std::vector<EigenTransform, Eigen::aligned_allocator<EigenTransform> > TransformVector;
+
+    explicit KinematicState():
+        firstChanged(0) {}
+    ~KinematicState() {}
+
+    /**
+     * Reads the kinematic structure of the model down from \e fromLink (or from the root
+     * link if \e fromLink is empty). All joint positions are initialized to 0.
+     */
+    bool init(UrdfTraverser& traverser, const std::string& fromLink = "");
+
+    /**
+     * Sets all joint positions. Only the joints whose value differs from the current one
+     * are marked as changed.
+     * \param positions joint positions, in the order of getJointNames().
+     * \return false if the size of \e positions doesn't match the number of degrees of freedom.
+     */
+    bool setJointPositions(const Eigen::VectorXd& positions);
+
+    /**
+     * Sets the position of one joint (index as in getJointNames()).
+     * \return false if the index is out of range.
+     */
+    bool setJointPosition(unsigned int jointIndex, double value);
+
+    /**
+     * Sets the position of one joint.
+     * \return false if \e jointName is not an active joint in the state.
+     */
+    bool setJointPosition(const std::string& jointName, double value);
+
+    /**
+     * Recomputes the transforms of the links below all joints which have changed since the
+     * last update. This is called by all methods returning link transforms, so it does
+     * not need to be called explicitly.
+     */
+    void update();
+
+    /**
+     * Computes the transforms of all links relative to the base link for each row of
+     * \e configurations (one configuration of size getNumDOF() per row). The current joint
+     * positions and link transforms of this state are not changed.
+     * The computation runs on blocks of configurations at once, joint by joint, with vectorized
+     * arithmetic, which is faster than calling setJointPositions() for each configuration (how
+     * much depends on the vector instructions the code is compiled for, see kinematics_benchmark).
+     * \return false if the number of columns doesn't match the number of degrees of freedom.
+     */
+    bool computeLinkTransforms(const Eigen::MatrixXd& configurations, LinkTransformBatch& result) const;
+
+    const Eigen::VectorXd& getJointPositions() const
+    {
+        return jointPositions;
+    }
+
+    // Number of degrees of freedom (active joints)
+    unsigned int getNumDOF() const
+    {
+        return jointNames.size();
+    }
+
+    unsigned int getNumLinks() const
+    {
+        return linkNames.size();
+    }
+
+    /**
+     * Names of the active joints, in the order in which the joint positions are specified
+     */
+    const std::vector<std::string>& getJointNames() const
+    {
+        return jointNames;
+    }
+
+    /**
+     * Names of the links. The first link is the base link (the link from which the state
+     * was initialized), and the link at index i > 0 is the child link of joint i - 1 in dependency order.
+     */
+    const std::vector<std::string>& getLinkNames() const
+    {
+        return linkNames;
+    }
+
+    /**
+     * \return the index of the link as in getLinkNames(), or -1 if the link is not in the state.
+     */
+    int getLinkIndex(const std::string& linkName) const;
+
+    /**
+     * \return the index of the joint as in getJointNames(), or -1 if the joint is not an active joint in the state.
+     */
+    int getJointIndex(const std::string& jointName) const;
+
+    /**
+     * Returns the transform of the link (index as in getLinkNames()) relative to the base link
+     */
+    const EigenTransform& getLinkTransform(unsigned int linkIndex)
+    {
+        update();
+        return linkTransforms[linkIndex];
+    }
+
+    /**
+     * Returns the transforms of all links relative to the base link, indexed as in getLinkNames().
+     */
+    const TransformVector& getLinkTransforms()
+    {
+        update();
+        return linkTransforms;
+    }
+
+    /**
+     * Returns the transform from link \e fromLink to link \e toLink, i.e. the pose of
+     * \e toLink in the frame of \e fromLink. Works for any two links in the state.
+     * \return false if any of the links is not in the state.
+     */
+    bool getTransform(const std::string& fromLink, const std::string& toLink, EigenTransform& result);
+
+    /**
+     * Same as other getTransform(), with indices as in getLinkNames().
+     */
+    EigenTransform getTransform(unsigned int fromLinkIndex, unsigned int toLinkIndex);
+
+    /**
+     * Returns the 4x4 matrix of getTransform(), or identity if any of the links is not in the state.
+     */
+    Eigen::Matrix4d getTransformMatrix(const std::string& fromLink, const std::string& toLink);
+
+    /**
+     * Computes the geometric Jacobian of link \e tipLink relative to link \e baseLink, expressed
+     * in the frame of \e baseLink, at the current joint positions. Rows 0-2 are the linear velocity
+     * of the origin of \e tipLink and rows 3-5 the angular velocity, column j belongs to joint j
+     * as in getJointNames(). The links can be anywhere in the tree: joints on the path from the
+     * common ancestor to \e tipLink move the tip, joints on the path to \e baseLink move the
+     * base (in the opposite direction), all other columns are zero.
+     * The columns are computed from the cached link transforms, and nothing is allocated.
+     * \param jacobian matrix of size 6 x getNumDOF(), owned by the caller.
+     * \return false if any of the links is not in the state, or the size of \e jacobian is wrong.
+     */
+    bool getJacobian(const std::string& baseLink, const std::string& tipLink,
+                     Eigen::Ref<Eigen::MatrixXd> jacobian);
+
+    /**
+     * Same as other getJacobian(), with indices as in getLinkNames().
+     */
+    bool getJacobian(unsigned int baseLinkIndex, unsigned int tipLinkIndex,
+                     Eigen::Ref<Eigen::MatrixXd> jacobian);
+
+    /**
+     * Computes the Jacobians as in getJacobian() for all configurations of \e transforms, which
+     * has been computed with computeLinkTransforms(). The Jacobians are stored in structure-of-arrays
+     * layout: entry (r, j) of the Jacobian of configuration i is \e jacobians (i, 6 * j + r).
+     * The joints between the links are found per block of \e transforms, and nothing is allocated.
+     * \param jacobians matrix of size transforms.getNumConfigurations() x (6 * getNumDOF()),
+     *      owned by the caller.
+     * \return false if any of the link indices is out of range, or a size doesn't match.
+     */
+    bool computeJacobians(const LinkTransformBatch& transforms, unsigned int baseLinkIndex,
+                          unsigned int tipLinkIndex, Eigen::Ref<Eigen::MatrixXd> jacobians) const;
+
+private:
+    /**
+     * Computes the transform of the child link of the joint from the transform of its parent link.
+     */
+    void updateJoint(unsigned int jointIndex);
+
+    /**
+     * Computes the link transforms for the configurations of one block of LinkTransformBatch
+     * (LinkTransformBatch::BLOCK_SIZE rows of \e configurations, column-major) into \e T, which
+     * points to the first column of the block.
+     */
+    void computeLinkTransformsBlock(const double* configurations, double* T) const;
+
+    /**
+     * Sets the Jacobian column of the joint (index in dependency order) for the tip at \e tipPosition,
+     * with \e sign = -1 if the joint moves the base. \e baseRotationT is the transposed rotation of the base link.
+     */
+    void setJacobianColumn(unsigned int jointIndex, const Eigen::Vector3d& tipPosition,
+                           const Eigen::Matrix3d& baseRotationT, double sign,
+                           Eigen::Ref<Eigen::MatrixXd>& jacobian) const;
+
+    /**
+     * Checks the link indices for getJacobian() and computeJacobians()
+     */
+    bool checkLinkIndices(unsigned int baseLinkIndex, unsigned int tipLinkIndex) const;
+
+    typedef std::unordered_map<std::string, int> NameIndexMap;
+
+    std::vector<std::string> linkNames;
+    std::vector<std::string> jointNames;
+    NameIndexMap linkIndices;
+    NameIndexMap jointIndices;
+
+    // per joint in dependency order (the child link of joint i is link i + 1)
+    std::vector<unsigned int> jointParentLink;
+    // per link, the number of joints between the base link and the link
+    std::vector<unsigned int> linkDepth;
+    // the joints below joint i are the joints i + 1 ... jointSubtreeEnd[i] - 1
+    std::vector<unsigned int> jointSubtreeEnd;
+    std::vector<int> jointType;
+    // index into jointPositions, or -1 for fixed joints
+    std::vector<int> jointDOF;
+    std::vector<Eigen::Vector3d> jointAxis;
+    TransformVector jointOrigin;
+
+    // Constants for computeLinkTransforms() per joint: the rotation relative to the parent link
+    // is jointRotationC + cos * jointRotationD + sin * jointRotationB for revolute joints and
+    // jointRotationD for all other joints. jointAxisInParent is the joint axis in the parent link frame.
+    std::vector<Eigen::Matrix3d> jointRotationB;
+    std::vector<Eigen::Matrix3d> jointRotationC;
+    std::vector<Eigen::Matrix3d> jointRotationD;
+    std::vector<Eigen::Vector3d> jointAxisInParent;
+
+    // joint index (in dependency order) of each degree of freedom
+    std::vector<unsigned int> dofJoint;
+
+    Eigen::VectorXd jointPositions;
+
+    // transforms of all links relative to the base link, updated in update()
+    TransformVector linkTransforms;
+    // joints changed since the last update, and the first of them (or the number of joints if none)
+    std::vector<char> jointChanged;
+    unsigned int firstChanged;
+};
+
+typedef KinematicState::Ptr KinematicStatePtr;
+
+}  // namespace urdf_traverser
+#endif  // URDF_TRAVERSER_KINEMATICSTATE_H
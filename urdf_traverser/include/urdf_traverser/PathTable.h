@@ -0,0 +1,173 @@
+/**
+ * <ORGANIZATION> = Jennifer Buehler
+ * <COPYRIGHT HOLDER> = Jennifer Buehler
+ *
+ * Copyright (c) 2016 Jennifer Buehler
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <ORGANIZATION> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ------------------------------------------------------------------------------
+ **/
+#ifndef URDF_TRAVERSER_PATHTABLE_H
+#define URDF_TRAVERSER_PATHTABLE_H
+// Copyright Jennifer Buehler
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace urdf_traverser
+{
+namespace helpers
+{
+
+/**
+ * \brief Table of interned paths for path arithmetic on many paths.
+ *
+ * Each distinct path is split into its components only once, and the components are
+ * stored as IDs, so that comparing paths needs neither boost::filesystem nor system calls
+ * other than one look-up of the current directory, which relative paths are resolved against.
+ * This is meant for computations on the same paths over and over again (e.g. relocating
+ * the textures of all meshes of a model): the cost is linear in the number of components
+ * of the paths involved.
+ *
+ * The methods give the same results as the functions of the same name in Helpers.h
+ * for paths which don't contain "." or ".." components or repeated separators,
+ * except that they also work where the common parent directory is the root directory,
+ * which the functions in Helpers.h can't handle.
+ *
+ * \author Jennifer Buehler
+ */
+class PathTable
+{
+public:
+    /**
+     * See urdf_traverser::helpers::getCommonParentPath(const std::set<std::string>&, std::string&).
+     * The common parent is the longest common prefix of the directories of all paths,
+     * determined in one pass over the paths.
+     */
+    bool getCommonParentPath(const std::set<std::string>& allFiles, std::string& result);
+
+    /**
+     * See urdf_traverser::helpers::getSubdirPath()
+     */
+    bool getSubdirPath(const std::string& from, const std::string& to, std::string& result);
+
+    /**
+     * See urdf_traverser::helpers::getRelativeDirectory()
+     */
+    bool getRelativeDirectory(const std::string& path, const std::string& relTo, std::string& result);
+
+private:
+    struct Path
+    {
+        // IDs of the components of the path as given, i.e. relative
+        // to the current directory if the path is relative
+        std::vector<unsigned int> components;
+        // the path ends with a separator
+        bool isDirectory;
+        bool isRelative;
+    };
+
+    /**
+     * Returns the interned path, splitting it into its components if it is not in the table yet
+     */
+    const Path& getPath(const std::string& path);
+
+    /**
+     * Reads the current directory, which relative paths are resolved against.
+     * Called at the beginning of each public method.
+     */
+    void updateCurrentDir();
+
+    /**
+     * Returns the number of components of the absolute path
+     */
+    size_t numComponents(const Path& path) const
+    {
+        if (!path.isRelative) return path.components.size();
+        return currentDir.size() + path.components.size();
+    }
+
+    /**
+     * Returns component \e i of the absolute path
+     */
+    unsigned int getComponent(const Path& path, size_t i) const
+    {
+        if (!path.isRelative) return path.components[i];
+        if (i < currentDir.size()) return currentDir[i];
+        return path.components[i - currentDir.size()];
+    }
+
+    /**
+     * Returns the number of components of the absolute directory of \e path
+     * (all components if it is a directory, all but the file name otherwise).
+     */
+    size_t getDirectoryLength(const Path& path) const
+    {
+        size_t len = numComponents(path);
+        if (path.isDirectory || (len == 0)) return len;
+        return len - 1;
+    }
+
+    /**
+     * Returns the number of leading components which the first \e len1 components
+     * of \e path1 and the first \e len2 components of \e path2 have in common.
+     */
+    size_t getCommonLength(const Path& path1, size_t len1, const Path& path2, size_t len2) const;
+
+    /**
+     * Returns the number of components of the common parent directory of \e path1 and \e path2,
+     * determined the same way as urdf_traverser::helpers::getCommonParentPath(const std::string&,
+     * const std::string&, std::string&) does it: The directory of the path with more directories
+     * is compared with all components of the other path (so a file name matches a directory of the same name).
+     */
+    size_t getCommonParentLength(const Path& path1, const Path& path2) const;
+
+    /**
+     * Returns the common parent directory made of the first \e commonLength components of \e path.
+     * If \e relative is true, the directory is returned relative to the current directory,
+     * and false is returned if it is not within the current directory.
+     */
+    bool getParentPath(const Path& path, size_t commonLength, bool relative, std::string& result) const;
+
+    /**
+     * Joins the components [\e from, \e to) of the absolute \e path, separated by '/'.
+     */
+    std::string join(const Path& path, size_t from, size_t to) const;
+
+    unsigned int getComponentId(const std::string& component);
+
+    std::map<std::string, unsigned int> componentIds;
+    std::vector<std::string> components;
+    // std::map, so that references to the paths stay valid when paths are added
+    std::map<std::string, Path> paths;
+    // the components of the current directory
+    std::vector<unsigned int> currentDir;
+};
+
+}  // namespace helpers
+}  // namespace urdf_traverser
+
+#endif  // URDF_TRAVERSER_PATHTABLE_H
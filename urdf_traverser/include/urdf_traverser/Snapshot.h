@@ -0,0 +1,63 @@
+/**
+ * <ORGANIZATION> = Jennifer Buehler
+ * <COPYRIGHT HOLDER> = Jennifer Buehler
+ *
+ * Copyright (c) 2016 Jennifer Buehler
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <ORGANIZATION> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ------------------------------------------------------------------------------
+ **/
+#ifndef URDF_TRAVERSER_SNAPSHOT_H
+#define URDF_TRAVERSER_SNAPSHOT_H
+// Copyright Jennifer Buehler
+
+#include <urdf_traverser/Types.h>
+#include <string>
+
+namespace urdf_traverser
+{
+
+/**
+ * Writes the model into \e buffer in the binary snapshot format: links (with inertials,
+ * visuals and collisions), joints, materials and the model directory \e modelDir.
+ * The order of the child links is kept, so traversals of the model read with readSnapshot()
+ * visit the links in the same order as in \e model. This is also the case if the model has
+ * been transformed (e.g. fixed links joined or scaled) after it was loaded from the URDF.
+ * The snapshot uses the byte order of this machine.
+ * \return false if the model has no root link.
+ */
+bool writeSnapshot(const urdf::Model& model, const std::string& modelDir, std::string& buffer);
+
+/**
+ * Reads a model written with writeSnapshot() from \e buffer. Nothing is parsed,
+ * the values are copied straight from the buffer.
+ * \param model the model to read into. Everything in it is replaced.
+ * \param modelDir the model directory which was saved in the snapshot.
+ * \return false if the buffer is not a valid snapshot (in which case \e model is not changed).
+ */
+bool readSnapshot(const std::string& buffer, urdf::Model& model, std::string& modelDir);
+
+}  // namespace urdf_traverser
+
+#endif  // URDF_TRAVERSER_SNAPSHOT_H
@@ -0,0 +1,274 @@
+/**
+ * <ORGANIZATION> = Jennifer Buehler
+ * <COPYRIGHT HOLDER> = Jennifer Buehler
+ *
+ * Copyright (c) 2016 Jennifer Buehler
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <ORGANIZATION> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ------------------------------------------------------------------------------
+ **/
+#ifndef URDF_TRAVERSER_TOPOLOGYINDEX_H
+#define URDF_TRAVERSER_TOPOLOGYINDEX_H
+// Copyright Jennifer Buehler
+
+#include <baselib_binding/SharedPtr.h>
+#include <urdf_traverser/Types.h>
+
+#include <Eigen/StdVector>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace urdf_traverser
+{
+
+/**
+ * \brief Flat, index-based representation of the link/joint tree of a urdf::Model.
+ *
+ * All links and joints of the model are assigned dense integer IDs (in the order of the
+ * model's name maps). The tree structure is kept in contiguous arrays (structure-of-arrays):
+ * parent link/joint per link, parent/child link per joint, and the children of each link
+ * in compressed form (offsets into one array of child link IDs and one of child joint IDs,
+ * in the same order as urdf::Link::child_links and urdf::Link::child_joints).
+ * Names are mapped to IDs with a hash table.
+ *
+ * For queries between arbitrary links, the depth of each link, its position in a depth-first
+ * traversal (for ancestor tests in constant time), a binary lifting table of ancestors (for
+ * the lowest common ancestor in O(log n)) and the transform of each link relative to the root
+ * are stored as well.
+ *
+ * The index is a snapshot of the model at the time build() was called. If the tree
+ * structure of the model or the joint origins change (e.g. links are re-linked when joining
+ * fixed links, or the model is scaled), the index has to be built again.
+ *
+ * \author Jennifer Buehler
+ */
+class TopologyIndex
+{
+public:
+    typedef baselib_binding::shared_ptr<TopologyIndex>::type Ptr;
+    typedef baselib_binding::shared_ptr<const TopologyIndex>::type ConstPtr;
+
+    // ID which is used for "no link" or "no joint", e.g. the parent of the root link.
+    static const int INVALID_ID = -1;
+
+    explicit TopologyIndex():
+        rootLink(INVALID_ID),
+        numAncestorLevels(0) {}
+    ~TopologyIndex() {}
+
+    /**
+     * Builds the index from the model. Any previous contents are cleared.
+     * \return false if the model is inconsistent (e.g. a joint references a link
+     *      which does not exist). The index is empty in this case.
+     */
+    bool build(const urdf::Model& model);
+
+    void clear();
+
+    bool empty() const
+    {
+        return links.empty();
+    }
+
+    unsigned int numLinks() const
+    {
+        return links.size();
+    }
+
+    unsigned int numJoints() const
+    {
+        return joints.size();
+    }
+
+    /**
+     * \return the ID of the link, or INVALID_ID if there is no such link
+     */
+    int getLinkId(const std::string& name) const
+    {
+        NameIdMap::const_iterator it = linkIds.find(name);
+        if (it == linkIds.end()) return INVALID_ID;
+        return it->second;
+    }
+
+    /**
+     * \return the ID of the joint, or INVALID_ID if there is no such joint
+     */
+    int getJointId(const std::string& name) const
+    {
+        NameIdMap::const_iterator it = jointIds.find(name);
+        if (it == jointIds.end()) return INVALID_ID;
+        return it->second;
+    }
+
+    const LinkPtr& getLink(int id) const
+    {
+        return links[id];
+    }
+
+    const JointPtr& getJoint(int id) const
+    {
+        return joints[id];
+    }
+
+    int getRootLinkId() const
+    {
+        return rootLink;
+    }
+
+    // ID of the parent link of the link, or INVALID_ID for the root
+    int getParentLinkId(int linkId) const
+    {
+        return linkParentLink[linkId];
+    }
+
+    // ID of the parent joint of the link, or INVALID_ID for the root
+    int getParentJointId(int linkId) const
+    {
+        return linkParentJoint[linkId];
+    }
+
+    int getJointParentLinkId(int jointId) const
+    {
+        return jointParentLink[jointId];
+    }
+
+    int getJointChildLinkId(int jointId) const
+    {
+        return jointChildLink[jointId];
+    }
+
+    unsigned int numChildren(int linkId) const
+    {
+        return childOffsets[linkId + 1] - childOffsets[linkId];
+    }
+
+    /**
+     * Returns the \e i-th child link ID of the link (same order as in urdf::Link::child_links)
+     */
+    int getChildLinkId(int linkId, unsigned int i) const
+    {
+        return childLinks[childOffsets[linkId] + i];
+    }
+
+    /**
+     * Returns the \e i-th child joint ID of the link (same order as in urdf::Link::child_joints)
+     */
+    int getChildJointId(int linkId, unsigned int i) const
+    {
+        return childJoints[childOffsets[linkId] + i];
+    }
+
+    /**
+     * Depth of the link in the tree, 0 for the root link.
+     * Links which are in the model but have been detached from the tree (e.g. after
+     * joining fixed links) are the roots of separate trees.
+     */
+    int getDepth(int linkId) const
+    {
+        return linkDepth[linkId];
+    }
+
+    /**
+     * \return true if \e linkId is \e ancestorId or a link below it in the tree.
+     */
+    bool isAncestor(int ancestorId, int linkId) const
+    {
+        return (linkEnter[ancestorId] <= linkEnter[linkId]) && (linkExit[linkId] <= linkExit[ancestorId]);
+    }
+
+    /**
+     * \return the lowest link which has both links below it (or is one of them), or INVALID_ID
+     *      if the links are not in the same tree.
+     */
+    int getCommonAncestor(int linkA, int linkB) const;
+
+    /**
+     * Transform of the link relative to the root link of its tree, with all joints at zero
+     * position, computed from the joint origins at the time the index was built.
+     */
+    const EigenTransform& getRootTransform(int linkId) const
+    {
+        return rootTransforms[linkId];
+    }
+
+    /**
+     * Gets the transform from link \e fromLinkId to link \e toLinkId (i.e. the pose of
+     * \e toLinkId in the frame of \e fromLinkId), with all joints at zero position.
+     * The links do not have to be on one chain (e.g. they can be siblings). The transform
+     * is computed from the cached root transforms of both links, so it doesn't depend on
+     * the length of the path between them.
+     * \return false if the links are not in the same tree.
+     */
+    bool getTransform(int fromLinkId, int toLinkId, EigenTransform& result) const;
+
+private:
+    typedef std::unordered_map<std::string, int> NameIdMap;
+    typedef std::vector<EigenTransform, Eigen::aligned_allocator<EigenTransform> > TransformVector;
+
+    /**
+     * Computes depth, depth-first traversal order, ancestor table and root transforms
+     * from the child arrays.
+     */
+    void buildAncestors();
+
+    NameIdMap linkIds;
+    NameIdMap jointIds;
+
+    std::vector<LinkPtr> links;
+    std::vector<JointPtr> joints;
+
+    int rootLink;
+
+    // per link
+    std::vector<int> linkParentLink;
+    std::vector<int> linkParentJoint;
+
+    // per joint
+    std::vector<int> jointParentLink;
+    std::vector<int> jointChildLink;
+
+    // children of link i are at indices [childOffsets[i], childOffsets[i+1])
+    // of childLinks and childJoints.
+    std::vector<unsigned int> childOffsets;
+    std::vector<int> childLinks;
+    std::vector<int> childJoints;
+
+    // per link: depth, and when the link is entered and left in a depth-first traversal
+    std::vector<int> linkDepth;
+    std::vector<unsigned int> linkEnter;
+    std::vector<unsigned int> linkExit;
+    TransformVector rootTransforms;
+
+    // the (2^k)-th ancestor of link i is at ancestors[k * numLinks() + i] (or INVALID_ID)
+    std::vector<int> ancestors;
+    unsigned int numAncestorLevels;
+};
+
+typedef TopologyIndex::Ptr TopologyIndexPtr;
+typedef TopologyIndex::ConstPtr TopologyIndexConstPtr;
+
+}  // namespace urdf_traverser
+#endif  // URDF_TRAVERSER_TOPOLOGYINDEX_H
@@ -37,11 +37,13 @@
 
 #include <urdf_traverser/Types.h>
 #include <urdf_traverser/RecursionParams.h>
+#include <urdf_traverser/TopologyIndex.h>
 
 #include <iostream>
 #include <string>
 #include <map>
 #include <vector>
+#include <deque>
 
 #define BOOST_NO_CXX11_SCOPED_ENUMS
 #include <boost/filesystem.hpp>
@@ -59,6 +61,8 @@ namespace urdf_traverser
  *
  *  Methods int traverseTreeTopDown() and traverseTreeBottomUp() can be used and will require a callback function
  *  for the traversal. An example of how to use the functions can for example be found in PrintModel.h or JointNames.h.
+ *  The template method traverse() does the same, but with visitor and parameter types which are
+ *  known at compile time. An example of this can be found in DependencyOrderedJoints.cpp.
  *
  * \author Jennifer Buehler
  * \date May 2016
@@ -68,9 +72,14 @@ class UrdfTraverser
 public:
 
     /**
+     * \param _useTopologyIndex use a TopologyIndex for lookups of links and joints
+     *      instead of the string-keyed maps of urdf::Model. See also setUseTopologyIndex().
      */
-    explicit UrdfTraverser():
-        model(new urdf::Model())
+    explicit UrdfTraverser(bool _useTopologyIndex = true):
+        model(new urdf::Model()),
+        topologyFailed(false),
+        useTopologyIndex(_useTopologyIndex),
+        traversalDepth(0)
     {}
 
     ~UrdfTraverser()
@@ -78,7 +87,8 @@ public:
     }
 
     /**
-     * Reads the URDF file from the filename into \e xml_string. Does not change
+     * Reads the URDF file from the filename into \e xml_string, replacing its contents.
+     * The file is read with a single read of the file size. Does not change
      * anything in the UrdfTraverser object. Result can be used with loadModelFromXMLString().
      */
     bool getModelFromFile(const std::string& urdfFilename, std::string& xml_string) const;
@@ -93,6 +103,20 @@ public:
      */
     bool loadModelFromXMLString(const std::string& xmlString);
 
+    /**
+     * Saves the model, including all changes which have been made to it since it was
+     * loaded (e.g. by joining fixed links or scaling), and the model directory to a binary
+     * snapshot file. Loading the snapshot with loadModelFromSnapshot() is a lot faster than
+     * parsing the URDF again. See also urdf_traverser::writeSnapshot().
+     */
+    bool saveSnapshot(const std::string& filename) const;
+
+    /**
+     * Loads the model and the model directory from a snapshot file written with saveSnapshot().
+     * Snapshots can only be read on machines with the same byte order.
+     */
+    bool loadModelFromSnapshot(const std::string& filename);
+
     /**
      * Set the directory which is considered the base of all
      * mesh and texture files. When loading the model URDF from file,
@@ -164,6 +188,21 @@ public:
                              boost::function< int(RecursionParamsPtr&)> link_cb,
                              RecursionParamsPtr& params, bool includeLink = true);
 
+    /**
+     * Traverses the tree starting from link \e linkName and calls \e visitor on each link.
+     * This is the same as traverseTreeTopDown(), or traverseTreeBottomUp() if \e bottomUp is true,
+     * except that the type of visitor and parameters are known at compile time. The visitor
+     * can be inlined, and the parameters don't need to be casted to their type in the visitor.
+     * \param visitor a function or an object with operator(), which is called as
+     *      ``int visitor(Params& params)``, with \e params set to the current link and level.
+     *      The return values are the same as for the callbacks of traverseTreeTopDown().
+     * \param params the recursion parameters, has to be RecursionParams or a subclass of it.
+     * \return the last return value of the visitor
+     */
+    template<class Visitor, class Params>
+    int traverse(const std::string& linkName, Visitor& visitor, Params& params,
+                 bool includeLink = true, bool bottomUp = false);
+
 
     JointPtr getJoint(const std::string& name);
     JointConstPtr readJoint(const std::string& name) const;
@@ -176,6 +215,27 @@ public:
     JointPtr getParentJoint(const JointConstPtr& joint);
     JointConstPtr readParentJoint(const JointConstPtr& joint) const;
 
+    /**
+     * \return true if link \e childName is a direct child link of link \e parentName.
+     * Uses the topology index if available, otherwise urdf_traverser::isChildOf().
+     */
+    bool isChildOf(const std::string& parentName, const std::string& childName);
+
+    /**
+     * \return true if joint \e jointName is a child joint of link \e parentName.
+     * Uses the topology index if available, otherwise urdf_traverser::isChildJointOf().
+     */
+    bool isChildJointOf(const std::string& parentName, const std::string& jointName);
+
+    /**
+     * Gets the transform from link \e fromLink to link \e toLink (i.e. the pose of \e toLink in
+     * the frame of \e fromLink) with all joints at zero position. With the topology index, this
+     * works for any two links in the tree and is computed from the root transforms cached in the
+     * index, otherwise \e fromLink has to be an ancestor of \e toLink (see urdf_traverser::getTransform()).
+     * \return false if the links don't exist or are not connected.
+     */
+    bool getTransform(const std::string& fromLink, const std::string& toLink, EigenTransform& result);
+
 
     ModelPtr getModel()
     {
@@ -186,6 +246,42 @@ public:
         return model;
     }
 
+    /**
+     * Enables or disables the use of the TopologyIndex for lookups of links and joints.
+     * If disabled, all lookups go through the maps of urdf::Model.
+     */
+    void setUseTopologyIndex(bool flag);
+
+    /**
+     * Returns the topology index of the model, and builds it first if it is
+     * not up to date. Returns NULL if the index is disabled or could not be built.
+     * If building the index failed, it is not attempted again until invalidateTopology() is called.
+     */
+    TopologyIndexConstPtr getTopology();
+
+    /**
+     * Returns the topology index of the model if it is up to date, or NULL otherwise.
+     */
+    TopologyIndexConstPtr readTopology() const
+    {
+        return topology;
+    }
+
+    /**
+     * Marks the topology index as outdated. It will be re-built on the next
+     * call of getTopology().
+     * This must be called when the tree structure of the model or the joint origins have been
+     * changed via getModel(), e.g. after re-linking links, changing the root link or transforming
+     * joints, because the index caches the transforms of the links.
+     * Note that traverseTreeBottomUp() calls this function after the traversal, because the
+     * callbacks may re-link the tree.
+     */
+    void invalidateTopology()
+    {
+        topology.reset();
+        topologyFailed = false;
+    }
+
     /**
      * Returns all joint names in depth-frist search order starting from \e fromLink (or from root if
      * \e fromLink is empty). Only joints *after* the given link are returned.
@@ -219,17 +315,40 @@ protected:
     int getChildJoint(const JointPtr& joint, JointPtr& child);
 
     /**
-     * Main recursive top-down traversal method, called from other traverseTreeTopDown().
+     * Main top-down traversal method, called from other traverseTreeTopDown().
      */
     int traverseTreeTopDown(const LinkPtr& link, boost::function< int(RecursionParamsPtr&)> link_cb,
                             RecursionParamsPtr& params, bool includeLink = true, unsigned int level = 0);
 
     /**
-     * Main recursive bottom-up traversal method, called from other traverseTreeBottomUp().
+     * Main bottom-up traversal method, called from other traverseTreeBottomUp().
      */
     int traverseTreeBottomUp(const LinkPtr& link, boost::function<int(RecursionParamsPtr&)> link_cb,
                              RecursionParamsPtr& params, bool includeLink = true, unsigned int level = 0);
 
+    /**
+     * Top-down traversal used by traverse() and traverseTreeTopDown().
+     * The traversal is done without recursion, using an explicit stack, so
+     * the depth of the tree is not limited by the call stack.
+     */
+    template<class Visitor, class Params>
+    int traverseTopDown(const LinkPtr& link, Visitor& visitor, Params& params,
+                        bool includeLink, unsigned int level);
+
+    /**
+     * Bottom-up traversal used by traverse() and traverseTreeBottomUp().
+     * The traversal is done without recursion, using an explicit stack, so
+     * the depth of the tree is not limited by the call stack.
+     * The children of each link are visited in the order of their names.
+     */
+    template<class Visitor, class Params>
+    int traverseBottomUp(const LinkPtr& link, Visitor& visitor, Params& params,
+                         bool includeLink, unsigned int level);
+
+    /**
+     * Checks the current child links of \e link. This does not use the topology index
+     * and can therefore be used to check for changes in the tree while it is being re-linked.
+     */
     bool hasChildLink(const LinkConstPtr& link, const std::string& childName) const;
 
 
@@ -237,6 +356,47 @@ protected:
 
 private:
 
+    /**
+     * One entry on the stack of a traversal: the link which is being traversed
+     * and the state of the traversal of its children.
+     */
+    struct TraversalFrame
+    {
+        TraversalFrame(const LinkPtr& _link, unsigned int _level, bool _includeLink = false,
+                       unsigned int _nextChild = 0, unsigned int _endChild = 0):
+            link(_link),
+            level(_level),
+            includeLink(_includeLink),
+            nextChild(_nextChild),
+            endChild(_endChild) {}
+        LinkPtr link;
+        // level of the link in the top-down traversal, and level of the link's
+        // children in the top-down traversal.
+        unsigned int level;
+        // bottom-up traversal only: call the callback on the link after its children are done
+        bool includeLink;
+        // index of the next child to visit. For the bottom-up traversal, this is an index into
+        // TraversalStack::children, for top-down it's an index into the link's child_links.
+        unsigned int nextChild;
+        // bottom-up traversal only: end index of the link's children in TraversalStack::children
+        unsigned int endChild;
+    };
+
+    /**
+     * The explicit stack of a traversal. Stacks are kept after the traversal so the
+     * memory can be re-used in the next traversal.
+     */
+    struct TraversalStack
+    {
+        std::vector<TraversalFrame> frames;
+        // bottom-up traversal only: the children of all links on the stack, stored when the
+        // traversal of the link starts, sorted by name.
+        std::vector<LinkPtr> children;
+    };
+
+    // Acquires a TraversalStack for the duration of one traversal.
+    class TraversalStackLock;
+
     /**
      * printing a link, used by recursive printModel().
      * Supports FlagRecursionParamsPtr, if the flag is true it prints verbose.
@@ -245,6 +405,23 @@ private:
 
     ModelPtr model;
 
+    // flat index of the model tree, NULL if not built or outdated
+    TopologyIndexPtr topology;
+
+    // building the topology index of the current model failed, so lookups
+    // go through the model until the index is invalidated
+    bool topologyFailed;
+
+    bool useTopologyIndex;
+
+    // One stack per nesting level of traversals, because callbacks may start
+    // traversals as well. std::deque doesn't invalidate references to stacks
+    // of outer traversals when adding stacks.
+    std::deque<TraversalStack> traversalStacks;
+
+    // Number of traversals currently running
+    unsigned int traversalDepth;
+
     /**
      * The directory which is considered the base of all
      * mesh and texture files of the model
@@ -253,4 +430,7 @@ private:
 };
 
 }  //  namespace urdf_traverser
+
+#include <urdf_traverser/UrdfTraverser.hpp>
+
 #endif   // URDF_TRAVERSER_URDFTRAVERSER_H
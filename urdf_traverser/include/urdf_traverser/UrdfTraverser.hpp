@@ -0,0 +1,256 @@
+/**
+ * <ORGANIZATION> = Jennifer Buehler
+ * <COPYRIGHT HOLDER> = Jennifer Buehler
+ *
+ * Copyright (c) 2016 Jennifer Buehler
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <ORGANIZATION> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ------------------------------------------------------------------------------
+ **/
+#include <ros/ros.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace urdf_traverser
+{
+
+/**
+ * Acquires the TraversalStack for the current nesting level of traversals,
+ * and clears it again when the traversal is done.
+ */
+class UrdfTraverser::TraversalStackLock
+{
+public:
+    explicit TraversalStackLock(UrdfTraverser& _traverser):
+        traverser(_traverser)
+    {
+        if (traverser.traversalStacks.size() <= traverser.traversalDepth)
+        {
+            traverser.traversalStacks.push_back(TraversalStack());
+        }
+        ++traverser.traversalDepth;
+    }
+    ~TraversalStackLock()
+    {
+        stack().frames.clear();
+        stack().children.clear();
+        --traverser.traversalDepth;
+    }
+    TraversalStack& stack()
+    {
+        return traverser.traversalStacks[traverser.traversalDepth - 1];
+    }
+private:
+    UrdfTraverser& traverser;
+};
+
+/**
+ * Compares links by name, used to sort the children in UrdfTraverser::traverseBottomUp().
+ */
+inline bool compareLinkNames(const LinkPtr& l1, const LinkPtr& l2)
+{
+    return l1->name < l2->name;
+}
+
+template<class Visitor, class Params>
+int UrdfTraverser::traverse(const std::string& linkName, Visitor& visitor, Params& params,
+                            bool includeLink, bool bottomUp)
+{
+    LinkPtr link = getLink(linkName);
+    if (!link)
+    {
+        ROS_ERROR_STREAM("Could not get Link " << linkName);
+        return -1;
+    }
+    if (!bottomUp)
+    {
+        return traverseTopDown(link, visitor, params, includeLink, 0);
+    }
+    int ret = traverseBottomUp(link, visitor, params, includeLink, 0);
+    // the visitor may have re-linked the tree
+    invalidateTopology();
+    return ret;
+}
+
+template<class Visitor, class Params>
+int UrdfTraverser::traverseTopDown(const LinkPtr& link, Visitor& visitor, Params& params,
+                                   bool includeLink, unsigned int level)
+{
+    if (includeLink)
+    {
+        params.setParams(link, level);
+        int link_ret = visitor(params);
+        if (link_ret <= 0)
+        {
+            // stopping traversal
+            return link_ret;
+        }
+    }
+
+    TraversalStackLock lock(*this);
+    std::vector<TraversalFrame>& frames = lock.stack().frames;
+    frames.push_back(TraversalFrame(link, level + 1));
+
+    while (true)
+    {
+        TraversalFrame& frame = frames.back();
+        // return value of the traversal of the link in \e frame
+        int ret = 1;
+        if (frame.nextChild < frame.link->child_links.size())
+        {
+            LinkPtr childLink = frame.link->child_links[frame.nextChild];
+            ++frame.nextChild;
+            if (childLink)
+            {
+                unsigned int childLevel = frame.level;
+                params.setParams(childLink, childLevel);
+                ret = visitor(params);
+                if (ret > 0)
+                {
+                    // go down the tree
+                    frames.push_back(TraversalFrame(childLink, childLevel + 1));
+                    continue;
+                }
+                // stopping traversal of this branch
+            }
+            else
+            {
+                ROS_ERROR("root link: %s has a null child!", frame.link->name.c_str());
+                ret = 0;
+            }
+        }
+
+        // traversal of the link on top of the stack is finished
+        // with ret, pass the result on to the parent(s).
+        while (true)
+        {
+            LinkPtr finished;
+            finished.swap(frames.back().link);
+            frames.pop_back();
+            if (frames.empty()) return ret;
+            if (ret >= 0) break;
+            ROS_ERROR("Error parsing branch of %s", finished->name.c_str());
+            ret = -1;
+        }
+    }
+    return 1;
+}
+
+template<class Visitor, class Params>
+int UrdfTraverser::traverseBottomUp(const LinkPtr& link, Visitor& visitor, Params& params,
+                                    bool includeLink, unsigned int level)
+{
+    TraversalStackLock lock(*this);
+    std::vector<TraversalFrame>& frames = lock.stack().frames;
+    std::vector<LinkPtr>& children = lock.stack().children;
+
+    LinkPtr nextLink = link;
+    unsigned int nextLevel = level;
+    bool nextInclude = includeLink;
+    while (true)
+    {
+        // return value of the traversal of the link on top of the stack
+        int ret = 1;
+        if (nextLink)
+        {
+            // Start traversal of a new link: Store the children as they are now, so
+            // that changes in the structure of the tree won't affect the traversal.
+            unsigned int beginChild = children.size();
+            for (unsigned int i = 0; i < nextLink->child_links.size(); ++i)
+            {
+                LinkPtr childLink = nextLink->child_links[i];
+                if (!childLink)
+                {
+                    ROS_ERROR("root link: %s has a null child!", nextLink->name.c_str());
+                    children.resize(beginChild);
+                    ret = -1;
+                    break;
+                }
+                children.push_back(childLink);
+            }
+            std::sort(children.begin() + beginChild, children.end(), compareLinkNames);
+            frames.push_back(TraversalFrame(nextLink, nextLevel, nextInclude, beginChild, children.size()));
+            nextLink.reset();
+        }
+
+        TraversalFrame& frame = frames.back();
+        if ((ret > 0) && (frame.nextChild < frame.endChild))
+        {
+            const LinkPtr& childLink = children[frame.nextChild];
+            ++frame.nextChild;
+            if (!hasChildLink(frame.link, childLink->name))
+            {
+                ROS_ERROR_STREAM("Consistency: Link " << frame.link->name
+                                 << " does not have child " << childLink->name << " any more.");
+                ret = -1;
+            }
+            else
+            {
+                // ROS_INFO("Traversal into child %s",childLink->name.c_str());
+                // go down the tree
+                nextLink = childLink;
+                nextLevel = frame.level + 1;
+                nextInclude = true;
+                continue;
+            }
+        }
+        else if ((ret > 0) && frame.includeLink)
+        {
+            // ROS_INFO("Callback for link %s",frame.link->name.c_str());
+            params.setParams(frame.link, frame.level);
+            ret = visitor(params);
+            if (ret < 0)
+            {
+                ROS_ERROR("Error parsing branch of %s", frame.link->name.c_str());
+                ret = -1;
+            }
+        }
+
+        // traversal of the link on top of the stack is finished
+        // with ret, pass the result on to the parent(s).
+        while (true)
+        {
+            LinkPtr finished;
+            finished.swap(frames.back().link);
+            frames.pop_back();
+            if (frames.empty()) return ret;
+            // the children of the finished link were added after the ones of its parent
+            children.resize(frames.back().endChild);
+            if (ret > 0) break;
+            if (ret == 0)
+            {
+                ROS_INFO("Stopping traversal at %s", finished->name.c_str());
+            }
+            else
+            {
+                ROS_ERROR("Error parsing branch of %s", finished->name.c_str());
+                ret = -1;
+            }
+        }
+    }
+    return 1;
+}
+
+}  // namespace urdf_traverser
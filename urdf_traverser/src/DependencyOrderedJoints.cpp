@@ -67,18 +67,17 @@ public:
     bool onlyActive;
 };
 
-// callback for getDependencyOrderedJoints()
-int addJointLink(urdf_traverser::RecursionParamsPtr& p)
+// visitor for getDependencyOrderedJoints()
+int addJointLink(OrderedJointsRecursionParams& param)
 {
-    OrderedJointsRecursionParams::Ptr param = baselib_binding_ns::dynamic_pointer_cast<OrderedJointsRecursionParams>(p);
-    if (!param || !param->getLink())
+    if (!param.getLink())
     {
-        ROS_ERROR("Wrong recursion parameter type, or NULL link");
+        ROS_ERROR("NULL link in recursion parameters");
         return -1;
     }
 
     // ROS_INFO("At link %s", parent->name.c_str());
-    urdf_traverser::LinkPtr link = param->getLink();
+    urdf_traverser::LinkPtr link = param.getLink();
     assert(link);
 
     urdf_traverser::LinkPtr parent = link->getParent();
@@ -94,7 +93,7 @@ int addJointLink(urdf_traverser::RecursionParamsPtr& p)
     }
     if (parent->child_joints.size() > 1)
     {
-        if (!param->allowSplits)
+        if (!param.allowSplits)
         {
             ROS_ERROR("Splitting point at %s!", parent->name.c_str());
             return -1;
@@ -102,14 +101,14 @@ int addJointLink(urdf_traverser::RecursionParamsPtr& p)
         // this is a splitting point, we have to add support for this
     }
 
-    if (param->onlyActive && !urdf_traverser::isActive(link->parent_joint))
+    if (param.onlyActive && !urdf_traverser::isActive(link->parent_joint))
     {
         // ROS_INFO("No type");
         return 1;
     }
 
     // ROS_INFO("Adding %s",link->parent_joint->name.c_str());
-    param->dependencyOrderedJoints.push_back(link->parent_joint);
+    param.dependencyOrderedJoints.push_back(link->parent_joint);
     return 1;
 }
 
@@ -154,16 +153,14 @@ bool urdf_traverser::getDependencyOrderedJoints(UrdfTraverser& traverser,
         ROS_ERROR("Splitting point at %s!", fromLink.c_str());
         return false;
     }
-    OrderedJointsRecursionParams * p = new OrderedJointsRecursionParams(allowSplits, onlyActive);
-    RecursionParamsPtr rp(p);
-    int travRet = traverser.traverseTreeTopDown(fromLink, boost::bind(&addJointLink, _1), rp, false);
+    OrderedJointsRecursionParams p(allowSplits, onlyActive);
+    int travRet = traverser.traverse(fromLink, addJointLink, p, false);
     if (travRet < 0)
     {
         ROS_ERROR("Could not add depenency order");
-        p->dependencyOrderedJoints.clear();
         return false;
     }
 
-    result = p->dependencyOrderedJoints;
+    result.swap(p.dependencyOrderedJoints);
     return true;
 }
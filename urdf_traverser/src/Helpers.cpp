@@ -35,7 +35,10 @@
 
 #include <fcntl.h>
 #include <fstream>
+#include <map>
+#include <sstream>
 #include <string>
+#include <vector>
 
 #define BOOST_NO_CXX11_SCOPED_ENUMS
 #include <boost/filesystem.hpp>
@@ -221,6 +224,153 @@ std::string urdf_traverser::helpers::replaceAll(const std::string& text, const s
     return ret;
 }
 
+namespace
+{
+
+/**
+ * Aho-Corasick automaton of a set of patterns, which replaceAll() uses to
+ * find all of the patterns in one pass over the text.
+ */
+class PatternAutomaton
+{
+public:
+    struct Node
+    {
+        std::map<char, unsigned int> children;
+        // node of the longest proper suffix of this node which is in the automaton
+        unsigned int fail;
+        // length of the string of this node
+        size_t depth;
+        // length of the longest pattern which is a suffix of this node, 0 if there is none
+        size_t matchLength;
+        // replacement of this longest pattern
+        const std::string * replacement;
+    };
+
+    explicit PatternAutomaton(const std::map<std::string, std::string>& patterns)
+    {
+        nodes.push_back(newNode(0));
+        for (std::map<std::string, std::string>::const_iterator it = patterns.begin(); it != patterns.end(); ++it)
+        {
+            if (it->first.empty()) continue;
+            unsigned int n = 0;
+            for (std::string::const_iterator c = it->first.begin(); c != it->first.end(); ++c)
+            {
+                std::map<char, unsigned int>::iterator child = nodes[n].children.find(*c);
+                if (child == nodes[n].children.end())
+                {
+                    nodes.push_back(newNode(nodes[n].depth + 1));
+                    child = nodes[n].children.insert(std::make_pair(*c, nodes.size() - 1)).first;
+                }
+                n = child->second;
+            }
+            nodes[n].matchLength = it->first.size();
+            nodes[n].replacement = &it->second;
+        }
+
+        // breadth-first, so that the fail nodes are complete before they are used
+        std::vector<unsigned int> queue(1, 0);
+        for (unsigned int i = 0; i < queue.size(); ++i)
+        {
+            const unsigned int n = queue[i];
+            for (std::map<char, unsigned int>::const_iterator c = nodes[n].children.begin();
+                    c != nodes[n].children.end(); ++c)
+            {
+                Node& child = nodes[c->second];
+                child.fail = (n == 0) ? 0 : next(nodes[n].fail, c->first);
+                if (child.matchLength == 0)
+                {
+                    child.matchLength = nodes[child.fail].matchLength;
+                    child.replacement = nodes[child.fail].replacement;
+                }
+                queue.push_back(c->second);
+            }
+        }
+    }
+
+    /**
+     * Returns the node reached from node \e n with character \e c
+     */
+    unsigned int next(unsigned int n, char c) const
+    {
+        while (true)
+        {
+            std::map<char, unsigned int>::const_iterator child = nodes[n].children.find(c);
+            if (child != nodes[n].children.end()) return child->second;
+            if (n == 0) return 0;
+            n = nodes[n].fail;
+        }
+    }
+
+    const Node& getNode(unsigned int n) const
+    {
+        return nodes[n];
+    }
+
+private:
+    static Node newNode(size_t depth)
+    {
+        Node node;
+        node.fail = 0;
+        node.depth = depth;
+        node.matchLength = 0;
+        node.replacement = NULL;
+        return node;
+    }
+
+    std::vector<Node> nodes;
+};
+
+}  // namespace
+
+std::string urdf_traverser::helpers::replaceAll(const std::string& text, const std::map<std::string, std::string>& replacements)
+{
+    PatternAutomaton automaton(replacements);
+    std::string ret;
+    ret.reserve(text.size());
+
+    // text before this position has been added to the result
+    size_t copied = 0;
+    // leftmost (and of those the longest) match found so far, which may still be
+    // superseded by a longer match at the same position
+    size_t matchStart = std::string::npos;
+    size_t matchLength = 0;
+    const std::string * matchReplacement = NULL;
+
+    unsigned int state = 0;
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+        state = automaton.next(state, text[pos]);
+        ++pos;
+        const PatternAutomaton::Node& node = automaton.getNode(state);
+        if (node.matchLength > 0)
+        {
+            size_t start = pos - node.matchLength;
+            if ((matchStart == std::string::npos) || (start < matchStart) ||
+                    ((start == matchStart) && (node.matchLength > matchLength)))
+            {
+                matchStart = start;
+                matchLength = node.matchLength;
+                matchReplacement = node.replacement;
+            }
+        }
+        // all matches still to be found start after pos - depth, so if this is after the
+        // match found (or the text ends), it is the final one. Matches must not overlap,
+        // so the search continues at the end of the match.
+        if ((matchStart != std::string::npos) && ((pos - node.depth > matchStart) || (pos == text.size())))
+        {
+            ret.append(text, copied, matchStart - copied);
+            ret.append(*matchReplacement);
+            copied = pos = matchStart + matchLength;
+            matchStart = std::string::npos;
+            state = 0;
+        }
+    }
+    ret.append(text, copied, std::string::npos);
+    return ret;
+}
+
 int numDirectories(const std::string& path)
 {
     // ROS_INFO_STREAM("cnt of path "<<path);
@@ -431,7 +581,7 @@ bool urdf_traverser::helpers::writeToFile(const std::string& content, const std:
         return false;
     }
 
-    std::ofstream outf(filename.c_str());
+    std::ofstream outf(filename.c_str(), std::ofstream::out | std::ofstream::binary);
     if (!outf)
     {
         ROS_ERROR("%s could not be opened for writing!", filename.c_str());
@@ -443,6 +593,39 @@ bool urdf_traverser::helpers::writeToFile(const std::string& content, const std:
 }
 
 
+bool urdf_traverser::helpers::readFromFile(const std::string& filename, std::string& content)
+{
+    std::ifstream inf(filename.c_str(), std::ifstream::in | std::ifstream::binary);
+    if (!inf.is_open())
+    {
+        ROS_ERROR("%s could not be opened for reading!", filename.c_str());
+        return false;
+    }
+
+    // read the whole file with one read into a string of the file size
+    inf.seekg(0, std::ifstream::end);
+    const std::streamoff size = inf.tellg();
+    inf.seekg(0, std::ifstream::beg);
+    if ((size < 0) || !inf.good())
+    {
+        // size not available (e.g. not a regular file), read until the end of the stream instead
+        inf.clear();
+        std::ostringstream str;
+        str << inf.rdbuf();
+        content = str.str();
+        return true;
+    }
+
+    content.resize(size);
+    if ((size > 0) && !inf.read(&content[0], size))
+    {
+        ROS_ERROR("%s could not be read!", filename.c_str());
+        content.clear();
+        return false;
+    }
+    return true;
+}
+
 // transforms a path specification in the form package://<package-name>/<path> to an absolute path on the computer
 std::string urdf_traverser::helpers::packagePathToAbsolute(std::string& packagePath)
 {
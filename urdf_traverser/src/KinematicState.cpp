@@ -0,0 +1,693 @@
+/**
+ * <ORGANIZATION> = Jennifer Buehler 
+ * <COPYRIGHT HOLDER> = Jennifer Buehler 
+ * 
+ * Copyright (c) 2016 Jennifer Buehler 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <ORGANIZATION> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ------------------------------------------------------------------------------
+ **/
+#include <ros/ros.h>
+#include <urdf_traverser/KinematicState.h>
+#include <urdf_traverser/UrdfTraverser.h>
+#include <urdf_traverser/DependencyOrderedJoints.h>
+#include <urdf_traverser/Functions.h>
+
+#include <algorithm>
+#include <utility>
+#include <string>
+#include <vector>
+
+using urdf_traverser::KinematicState;
+using urdf_traverser::LinkTransformBatch;
+
+const unsigned int LinkTransformBatch::NUM_ELEMENTS = 12;
+const unsigned int LinkTransformBatch::BLOCK_SIZE;
+
+urdf_traverser::EigenTransform LinkTransformBatch::getTransform(unsigned int config, unsigned int linkIndex) const
+{
+    const unsigned int blockSize = data.rows();
+    const unsigned int c = getBlock(config / blockSize) + linkIndex * NUM_ELEMENTS;
+    config = config % blockSize;
+    EigenTransform t = EigenTransform::Identity();
+    for (unsigned int r = 0; r < 3; ++r)
+    {
+        for (unsigned int col = 0; col < 3; ++col)
+        {
+            t.matrix()(r, col) = data(config, c + 3 * r + col);
+        }
+        t.matrix()(r, 3) = data(config, c + 9 + r);
+    }
+    return t;
+}
+
+bool KinematicState::init(UrdfTraverser& traverser, const std::string& fromLink)
+{
+    std::string baseLink = fromLink;
+    if (baseLink.empty()) baseLink = traverser.getRootLinkName();
+    if (!traverser.getLink(baseLink))
+    {
+        ROS_ERROR("KinematicState: Link %s not found", baseLink.c_str());
+        return false;
+    }
+
+    std::vector<JointPtr> joints;
+    if (!urdf_traverser::getDependencyOrderedJoints(traverser, joints, baseLink, true, false))
+    {
+        ROS_ERROR("KinematicState: Could not get dependency ordered joints from %s", baseLink.c_str());
+        return false;
+    }
+
+    const unsigned int numJoints = joints.size();
+    linkNames.clear();
+    jointNames.clear();
+    linkIndices.clear();
+    jointIndices.clear();
+    jointParentLink.clear();
+    linkDepth.clear();
+    jointType.clear();
+    jointDOF.clear();
+    jointAxis.clear();
+    jointOrigin.clear();
+    jointRotationB.clear();
+    jointRotationC.clear();
+    jointRotationD.clear();
+    jointAxisInParent.clear();
+    dofJoint.clear();
+
+    linkNames.reserve(numJoints + 1);
+    linkDepth.reserve(numJoints + 1);
+    jointParentLink.reserve(numJoints);
+    jointType.reserve(numJoints);
+    jointDOF.reserve(numJoints);
+    jointAxis.reserve(numJoints);
+    jointOrigin.reserve(numJoints);
+    jointRotationB.reserve(numJoints);
+    jointRotationC.reserve(numJoints);
+    jointRotationD.reserve(numJoints);
+    jointAxisInParent.reserve(numJoints);
+
+    linkNames.push_back(baseLink);
+    linkIndices[baseLink] = 0;
+    linkDepth.push_back(0);
+
+    for (unsigned int i = 0; i < numJoints; ++i)
+    {
+        const JointPtr& joint = joints[i];
+        // joints are in dependency order, so the parent link has been added already
+        NameIndexMap::const_iterator pIt = linkIndices.find(joint->parent_link_name);
+        if (pIt == linkIndices.end())
+        {
+            ROS_ERROR("KinematicState: Parent link %s of joint %s comes after the joint",
+                      joint->parent_link_name.c_str(), joint->name.c_str());
+            return false;
+        }
+        jointParentLink.push_back(pIt->second);
+        linkIndices[joint->child_link_name] = linkNames.size();
+        linkNames.push_back(joint->child_link_name);
+        linkDepth.push_back(linkDepth[pIt->second] + 1);
+
+        int dof = -1;
+        if (urdf_traverser::isActive(joint))
+        {
+            dof = jointNames.size();
+            jointIndices[joint->name] = dof;
+            jointNames.push_back(joint->name);
+            dofJoint.push_back(i);
+        }
+        jointType.push_back(joint->type);
+        jointDOF.push_back(dof);
+        // the origin is converted only once here, including normalization of the quaternion
+        jointOrigin.push_back(urdf_traverser::getTransform(joint));
+        Eigen::Vector3d axis(joint->axis.x, joint->axis.y, joint->axis.z);
+        if ((dof >= 0) && (axis.norm() > 1e-09)) axis.normalize();
+        jointAxis.push_back(axis);
+
+        const Eigen::Matrix3d R = jointOrigin.back().linear();
+        if ((dof >= 0) && ((joint->type == urdf::Joint::REVOLUTE) || (joint->type == urdf::Joint::CONTINUOUS)))
+        {
+            // Rotation of the joint relative to the parent link, with Rodrigues' formula:
+            // M = R * (cos*I + sin*[a]x + (1-cos)*a*a^T) = C + cos*(R-C) + sin*B
+            Eigen::Matrix3d K;
+            K << 0, -axis.z(), axis.y(),
+              axis.z(), 0, -axis.x(),
+              -axis.y(), axis.x(), 0;
+            jointRotationB.push_back(R * K);
+            jointRotationC.push_back((R * axis) * axis.transpose());
+            jointRotationD.push_back(R - jointRotationC.back());
+        }
+        else
+        {
+            jointRotationB.push_back(Eigen::Matrix3d::Zero());
+            jointRotationC.push_back(Eigen::Matrix3d::Zero());
+            jointRotationD.push_back(R);
+        }
+        jointAxisInParent.push_back(R * axis);
+    }
+
+    // joints are in depth-first order, so the joints below a joint directly follow it
+    jointSubtreeEnd.resize(numJoints);
+    for (unsigned int i = 0; i < numJoints; ++i)
+    {
+        jointSubtreeEnd[i] = i + 1;
+    }
+    for (int i = numJoints - 1; i >= 0; --i)
+    {
+        const unsigned int parentLink = jointParentLink[i];
+        if ((parentLink > 0) && (jointSubtreeEnd[parentLink - 1] < jointSubtreeEnd[i]))
+        {
+            jointSubtreeEnd[parentLink - 1] = jointSubtreeEnd[i];
+        }
+    }
+
+    linkTransforms.assign(linkNames.size(), EigenTransform::Identity());
+    jointPositions = Eigen::VectorXd::Zero(jointNames.size());
+    // all transforms are computed at the first update
+    jointChanged.assign(numJoints, 1);
+    firstChanged = 0;
+    return true;
+}
+
+bool KinematicState::setJointPositions(const Eigen::VectorXd& positions)
+{
+    if (positions.size() != jointPositions.size())
+    {
+        ROS_ERROR("KinematicState: Expected %i joint positions, got %i",
+                  static_cast<int>(jointPositions.size()), static_cast<int>(positions.size()));
+        return false;
+    }
+    for (unsigned int i = 0; i < jointNames.size(); ++i)
+    {
+        if (positions[i] != jointPositions[i]) setJointPosition(i, positions[i]);
+    }
+    return true;
+}
+
+bool KinematicState::setJointPosition(unsigned int jointIndex, double value)
+{
+    if (jointIndex >= jointNames.size())
+    {
+        ROS_ERROR("KinematicState: Joint index %u out of range", jointIndex);
+        return false;
+    }
+    jointPositions[jointIndex] = value;
+    const unsigned int joint = dofJoint[jointIndex];
+    jointChanged[joint] = 1;
+    if (joint < firstChanged) firstChanged = joint;
+    return true;
+}
+
+bool KinematicState::setJointPosition(const std::string& jointName, double value)
+{
+    int idx = getJointIndex(jointName);
+    if (idx < 0)
+    {
+        ROS_ERROR("KinematicState: Joint %s not found", jointName.c_str());
+        return false;
+    }
+    return setJointPosition(idx, value);
+}
+
+void KinematicState::update()
+{
+    const unsigned int numJoints = jointOrigin.size();
+    // all joints before updateEnd are below a changed joint
+    unsigned int updateEnd = firstChanged;
+    for (unsigned int i = firstChanged; i < numJoints; ++i)
+    {
+        if (jointChanged[i])
+        {
+            jointChanged[i] = 0;
+            if (updateEnd < jointSubtreeEnd[i]) updateEnd = jointSubtreeEnd[i];
+        }
+        if (i < updateEnd) updateJoint(i);
+    }
+    firstChanged = numJoints;
+}
+
+bool KinematicState::computeLinkTransforms(const Eigen::MatrixXd& configurations, LinkTransformBatch& result) const
+{
+    if (configurations.cols() != jointPositions.size())
+    {
+        ROS_ERROR("KinematicState: Expected %i joint positions per configuration, got %i",
+                  static_cast<int>(jointPositions.size()), static_cast<int>(configurations.cols()));
+        return false;
+    }
+
+    const unsigned int numConfigs = configurations.rows();
+    // The configurations are processed in blocks which are small enough so that the
+    // transforms of one block stay in the cache while going through the joints.
+    // Each block is written to its own contiguous part of the result.
+    const unsigned int blockSize = LinkTransformBatch::BLOCK_SIZE;
+    const unsigned int numBlocks = (numConfigs + blockSize - 1) / blockSize;
+    const unsigned int blockCols = linkNames.size() * LinkTransformBatch::NUM_ELEMENTS;
+    result.numConfigurations = numConfigs;
+    result.numLinks = linkNames.size();
+    result.data.resize(blockSize, numBlocks * blockCols);
+
+    Eigen::MatrixXd q = Eigen::MatrixXd::Zero(blockSize, configurations.cols());
+    for (unsigned int b = 0; b < numBlocks; ++b)
+    {
+        const unsigned int startRow = b * blockSize;
+        // the remaining rows of the last block keep the previous values
+        const unsigned int n = std::min(blockSize, numConfigs - startRow);
+        q.topRows(n) = configurations.middleRows(startRow, n);
+        computeLinkTransformsBlock(q.data(), result.data.data() + result.getBlock(b) * blockSize);
+    }
+    return true;
+}
+
+namespace
+{
+// One column of a block of LinkTransformBatch. The columns of a block are contiguous, so they
+// can be mapped as fixed-size arrays, for which Eigen generates unrolled, vectorized code.
+typedef Eigen::Array<double, LinkTransformBatch::BLOCK_SIZE, 1> BlockColumn;
+typedef Eigen::Map<BlockColumn> BlockColumnMap;
+typedef Eigen::Map<const BlockColumn> ConstBlockColumnMap;
+
+inline BlockColumnMap blockColumn(double* block, unsigned int col)
+{
+    return BlockColumnMap(block + col * LinkTransformBatch::BLOCK_SIZE);
+}
+
+inline ConstBlockColumnMap blockColumn(const double* block, unsigned int col)
+{
+    return ConstBlockColumnMap(block + col * LinkTransformBatch::BLOCK_SIZE);
+}
+}  // namespace
+
+/**
+ * Computes cos and sin of all values in \e x. Unlike Eigen's cos() and sin(), this is vectorized
+ * for double precision. Range reduction to [-pi/4, pi/4] is done with the three-part pi/2
+ * of fdlibm, which is accurate for |x| < 1e5, larger values fall back to cos() and sin().
+ * The polynomials are the ones of fdlibm's __kernel_sin and __kernel_cos.
+ */
+static void sinCos(const ConstBlockColumnMap& x, BlockColumn& c, BlockColumn& s)
+{
+    if ((x.abs() > 1e5).any())
+    {
+        c = x.cos();
+        s = x.sin();
+        return;
+    }
+
+    static const double TWO_OVER_PI = 6.36619772367581382433e-01;
+    static const double PIO2_1 = 1.57079632673412561417e+00;
+    static const double PIO2_2 = 6.07710050630396597660e-11;
+    static const double PIO2_3 = 2.02226624871116645580e-21;
+
+    // x = k * pi/2 + r
+    const BlockColumn k = (x * TWO_OVER_PI + 0.5).floor();
+    const BlockColumn r = x - k * PIO2_1 - k * PIO2_2 - k * PIO2_3;
+
+    const BlockColumn z = r.square();
+    const BlockColumn sinR = r + r * z * (-1.66666666666666324348e-01 + z * (8.33333333332248946124e-03
+                                          + z * (-1.98412698298579493134e-04 + z * (2.75573137070700676789e-06
+                                                  + z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10)))));
+    const BlockColumn cosR = 1.0 - 0.5 * z + z.square() * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03
+                             + z * (2.48015872894767294178e-05 + z * (-2.75573143513906633035e-07
+                                     + z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11)))));
+
+    // with the quadrant m = k mod 4 = 2 * h + odd:
+    // sin(x) = (-1)^h * (odd ? cos(r) : sin(r)), and cos(x) = (-1)^(h xor odd) * (odd ? sin(r) : cos(r))
+    const BlockColumn m = k - 4.0 * (k * 0.25).floor();
+    const BlockColumn h = (m * 0.5).floor();
+    const BlockColumn odd = m - 2.0 * h;
+    s = (1.0 - 2.0 * h) * (sinR + odd * (cosR - sinR));
+    c = (1.0 - 2.0 * (h + odd - 2.0 * h * odd)) * (cosR + odd * (sinR - cosR));
+}
+
+void KinematicState::computeLinkTransformsBlock(const double* configurations, double* T) const
+{
+    const unsigned int E = LinkTransformBatch::NUM_ELEMENTS;
+    const unsigned int numJoints = jointOrigin.size();
+
+    // the base link is at identity
+    for (unsigned int e = 0; e < E; ++e)
+    {
+        blockColumn(T, e).setConstant(((e == 0) || (e == 4) || (e == 8)) ? 1.0 : 0.0);
+    }
+
+    BlockColumn cosValues, sinValues;
+    // rotation of the joint relative to the parent link, row-major
+    BlockColumn M[9];
+    for (unsigned int i = 0; i < numJoints; ++i)
+    {
+        const double* parent = T + jointParentLink[i] * E * LinkTransformBatch::BLOCK_SIZE;
+        double* child = T + (i + 1) * E * LinkTransformBatch::BLOCK_SIZE;
+        const Eigen::Vector3d t = jointOrigin[i].translation();
+        const Eigen::Matrix3d& D = jointRotationD[i];
+        const int dof = jointDOF[i];
+        const int type = (dof < 0) ? static_cast<int>(urdf::Joint::FIXED) : jointType[i];
+
+        if ((type == urdf::Joint::REVOLUTE) || (type == urdf::Joint::CONTINUOUS))
+        {
+            const Eigen::Matrix3d& B = jointRotationB[i];
+            const Eigen::Matrix3d& C = jointRotationC[i];
+            sinCos(blockColumn(configurations, dof), cosValues, sinValues);
+            for (unsigned int r = 0; r < 3; ++r)
+            {
+                for (unsigned int col = 0; col < 3; ++col)
+                {
+                    M[3 * r + col] = C(r, col) + cosValues * D(r, col) + sinValues * B(r, col);
+                }
+            }
+            for (unsigned int r = 0; r < 3; ++r)
+            {
+                for (unsigned int col = 0; col < 3; ++col)
+                {
+                    blockColumn(child, 3 * r + col) = blockColumn(parent, 3 * r) * M[col] + blockColumn(parent, 3 * r + 1) * M[3 + col]
+                                                  + blockColumn(parent, 3 * r + 2) * M[6 + col];
+                }
+            }
+        }
+        else
+        {
+            // the rotation relative to the parent link is constant
+            for (unsigned int r = 0; r < 3; ++r)
+            {
+                for (unsigned int col = 0; col < 3; ++col)
+                {
+                    blockColumn(child, 3 * r + col) = blockColumn(parent, 3 * r) * D(0, col) + blockColumn(parent, 3 * r + 1) * D(1, col)
+                                                  + blockColumn(parent, 3 * r + 2) * D(2, col);
+                }
+            }
+        }
+
+        if (type == urdf::Joint::PRISMATIC)
+        {
+            // translation relative to the parent link: t + R * a * value
+            const Eigen::Vector3d& v = jointAxisInParent[i];
+            const ConstBlockColumnMap value = blockColumn(configurations, dof);
+            for (unsigned int r = 0; r < 3; ++r)
+            {
+                blockColumn(child, 9 + r) = blockColumn(parent, 3 * r) * (t.x() + value * v.x())
+                                        + blockColumn(parent, 3 * r + 1) * (t.y() + value * v.y())
+                                        + blockColumn(parent, 3 * r + 2) * (t.z() + value * v.z()) + blockColumn(parent, 9 + r);
+            }
+        }
+        else
+        {
+            for (unsigned int r = 0; r < 3; ++r)
+            {
+                blockColumn(child, 9 + r) = blockColumn(parent, 3 * r) * t.x() + blockColumn(parent, 3 * r + 1) * t.y()
+                                        + blockColumn(parent, 3 * r + 2) * t.z() + blockColumn(parent, 9 + r);
+            }
+        }
+    }
+}
+
+void KinematicState::updateJoint(unsigned int jointIndex)
+{
+    EigenTransform& linkTransform = linkTransforms[jointIndex + 1];
+    linkTransform = linkTransforms[jointParentLink[jointIndex]] * jointOrigin[jointIndex];
+    const int dof = jointDOF[jointIndex];
+    if (dof < 0) return;
+
+    const double value = jointPositions[dof];
+    switch (jointType[jointIndex])
+    {
+    case urdf::Joint::REVOLUTE:
+    case urdf::Joint::CONTINUOUS:
+    {
+        linkTransform.rotate(Eigen::AngleAxisd(value, jointAxis[jointIndex]));
+        break;
+    }
+    case urdf::Joint::PRISMATIC:
+    {
+        linkTransform.translate(jointAxis[jointIndex] * value);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+int KinematicState::getLinkIndex(const std::string& linkName) const
+{
+    NameIndexMap::const_iterator it = linkIndices.find(linkName);
+    if (it == linkIndices.end()) return -1;
+    return it->second;
+}
+
+int KinematicState::getJointIndex(const std::string& jointName) const
+{
+    NameIndexMap::const_iterator it = jointIndices.find(jointName);
+    if (it == jointIndices.end()) return -1;
+    return it->second;
+}
+
+urdf_traverser::EigenTransform KinematicState::getTransform(unsigned int fromLinkIndex, unsigned int toLinkIndex)
+{
+    update();
+    // transforms are rigid, so the inverse can be computed from the transposed rotation
+    return linkTransforms[fromLinkIndex].inverse(Eigen::Isometry) * linkTransforms[toLinkIndex];
+}
+
+bool KinematicState::getTransform(const std::string& fromLink, const std::string& toLink, EigenTransform& result)
+{
+    int fromIdx = getLinkIndex(fromLink);
+    if (fromIdx < 0)
+    {
+        ROS_ERROR("KinematicState: Link %s not found", fromLink.c_str());
+        return false;
+    }
+    int toIdx = getLinkIndex(toLink);
+    if (toIdx < 0)
+    {
+        ROS_ERROR("KinematicState: Link %s not found", toLink.c_str());
+        return false;
+    }
+    result = getTransform(fromIdx, toIdx);
+    return true;
+}
+
+Eigen::Matrix4d KinematicState::getTransformMatrix(const std::string& fromLink, const std::string& toLink)
+{
+    EigenTransform t;
+    if (!getTransform(fromLink, toLink, t)) return Eigen::Matrix4d::Identity();
+    return t.matrix();
+}
+
+bool KinematicState::checkLinkIndices(unsigned int baseLinkIndex, unsigned int tipLinkIndex) const
+{
+    if ((baseLinkIndex >= linkNames.size()) || (tipLinkIndex >= linkNames.size()))
+    {
+        ROS_ERROR("KinematicState: Link index %u or %u out of range", baseLinkIndex, tipLinkIndex);
+        return false;
+    }
+    return true;
+}
+
+bool KinematicState::getJacobian(const std::string& baseLink, const std::string& tipLink,
+                                 Eigen::Ref<Eigen::MatrixXd> jacobian)
+{
+    int baseIdx = getLinkIndex(baseLink);
+    if (baseIdx < 0)
+    {
+        ROS_ERROR("KinematicState: Link %s not found", baseLink.c_str());
+        return false;
+    }
+    int tipIdx = getLinkIndex(tipLink);
+    if (tipIdx < 0)
+    {
+        ROS_ERROR("KinematicState: Link %s not found", tipLink.c_str());
+        return false;
+    }
+    return getJacobian(baseIdx, tipIdx, jacobian);
+}
+
+bool KinematicState::getJacobian(unsigned int baseLinkIndex, unsigned int tipLinkIndex,
+                                 Eigen::Ref<Eigen::MatrixXd> jacobian)
+{
+    if (!checkLinkIndices(baseLinkIndex, tipLinkIndex)) return false;
+    if ((jacobian.rows() != 6) || (jacobian.cols() != jointPositions.size()))
+    {
+        ROS_ERROR("KinematicState: Jacobian has to be a 6 x %i matrix, got %i x %i",
+                  static_cast<int>(jointPositions.size()),
+                  static_cast<int>(jacobian.rows()), static_cast<int>(jacobian.cols()));
+        return false;
+    }
+
+    update();
+    jacobian.setZero();
+    const Eigen::Vector3d tipPosition = linkTransforms[tipLinkIndex].translation();
+    const Eigen::Matrix3d baseRotationT = linkTransforms[baseLinkIndex].linear().transpose();
+
+    // go up from both links until they meet at the common ancestor
+    unsigned int tip = tipLinkIndex;
+    unsigned int base = baseLinkIndex;
+    while (tip != base)
+    {
+        if (linkDepth[tip] >= linkDepth[base])
+        {
+            setJacobianColumn(tip - 1, tipPosition, baseRotationT, 1.0, jacobian);
+            tip = jointParentLink[tip - 1];
+        }
+        else
+        {
+            setJacobianColumn(base - 1, tipPosition, baseRotationT, -1.0, jacobian);
+            base = jointParentLink[base - 1];
+        }
+    }
+    return true;
+}
+
+void KinematicState::setJacobianColumn(unsigned int jointIndex, const Eigen::Vector3d& tipPosition,
+                                       const Eigen::Matrix3d& baseRotationT, double sign,
+                                       Eigen::Ref<Eigen::MatrixXd>& jacobian) const
+{
+    const int dof = jointDOF[jointIndex];
+    if (dof < 0) return;
+
+    // the joint frame is the frame of its child link, and the axis is the same before and after the motion
+    const EigenTransform& jointTransform = linkTransforms[jointIndex + 1];
+    const Eigen::Vector3d axis = jointTransform.linear() * jointAxis[jointIndex];
+    switch (jointType[jointIndex])
+    {
+    case urdf::Joint::REVOLUTE:
+    case urdf::Joint::CONTINUOUS:
+    {
+        jacobian.block<3, 1>(0, dof) = sign * (baseRotationT * axis.cross(tipPosition - jointTransform.translation()));
+        jacobian.block<3, 1>(3, dof) = sign * (baseRotationT * axis);
+        break;
+    }
+    case urdf::Joint::PRISMATIC:
+    {
+        jacobian.block<3, 1>(0, dof) = sign * (baseRotationT * axis);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+bool KinematicState::computeJacobians(const LinkTransformBatch& transforms, unsigned int baseLinkIndex,
+                                      unsigned int tipLinkIndex, Eigen::Ref<Eigen::MatrixXd> jacobians) const
+{
+    if (!checkLinkIndices(baseLinkIndex, tipLinkIndex)) return false;
+    if (transforms.getNumLinks() != linkNames.size())
+    {
+        ROS_ERROR("KinematicState: Expected transforms of %i links, got %i",
+                  static_cast<int>(linkNames.size()), static_cast<int>(transforms.getNumLinks()));
+        return false;
+    }
+    const unsigned int numConfigs = transforms.getNumConfigurations();
+    if ((jacobians.rows() != numConfigs) || (jacobians.cols() != 6 * jointPositions.size()))
+    {
+        ROS_ERROR("KinematicState: Jacobians have to be a %i x %i matrix, got %i x %i",
+                  static_cast<int>(numConfigs), static_cast<int>(6 * jointPositions.size()),
+                  static_cast<int>(jacobians.rows()), static_cast<int>(jacobians.cols()));
+        return false;
+    }
+
+    jacobians.setZero();
+
+    const unsigned int E = LinkTransformBatch::NUM_ELEMENTS;
+    const Eigen::ArrayXXd& T = transforms.data;
+    const unsigned int blockSize = transforms.getBlockSize();
+    // axis in columns 0-2, tip relative to the joint in 3-5, linear velocity in 6-8.
+    // The blocks have BLOCK_SIZE rows, so this is on the stack.
+    Eigen::Array<double, LinkTransformBatch::BLOCK_SIZE, 9> work;
+    for (unsigned int b = 0; b * blockSize < numConfigs; ++b)
+    {
+        const unsigned int startRow = b * blockSize;
+        const unsigned int n = std::min(blockSize, numConfigs - startRow);
+        const unsigned int tipCol = transforms.getBlock(b) + tipLinkIndex * E;
+        const unsigned int baseCol = transforms.getBlock(b) + baseLinkIndex * E;
+
+        // go up from both links until they meet at the common ancestor,
+        // with sign -1 for the joints moving the base
+        unsigned int tip = tipLinkIndex;
+        unsigned int base = baseLinkIndex;
+        while (tip != base)
+        {
+            unsigned int joint;
+            double sign;
+            if (linkDepth[tip] >= linkDepth[base])
+            {
+                joint = tip - 1;
+                sign = 1.0;
+                tip = jointParentLink[joint];
+            }
+            else
+            {
+                joint = base - 1;
+                sign = -1.0;
+                base = jointParentLink[joint];
+            }
+            if (jointDOF[joint] < 0) continue;
+
+            const unsigned int c = transforms.getBlock(b) + (joint + 1) * E;
+            const Eigen::Vector3d& a = jointAxis[joint];
+            const unsigned int outCol = 6 * jointDOF[joint];
+
+            for (unsigned int r = 0; r < 3; ++r)
+            {
+                work.col(r).head(n) = T.col(c + 3 * r).head(n) * a.x() + T.col(c + 3 * r + 1).head(n) * a.y()
+                                      + T.col(c + 3 * r + 2).head(n) * a.z();
+            }
+
+            // the linear velocity (before rotating into the base frame) is in 'lin'
+            unsigned int lin = 0;
+            if ((jointType[joint] == urdf::Joint::REVOLUTE) || (jointType[joint] == urdf::Joint::CONTINUOUS))
+            {
+                for (unsigned int r = 0; r < 3; ++r)
+                {
+                    work.col(3 + r).head(n) = T.col(tipCol + 9 + r).head(n) - T.col(c + 9 + r).head(n);
+                }
+                for (unsigned int r = 0; r < 3; ++r)
+                {
+                    const unsigned int r1 = (r + 1) % 3;
+                    const unsigned int r2 = (r + 2) % 3;
+                    work.col(6 + r).head(n) = work.col(r1).head(n) * work.col(3 + r2).head(n)
+                                              - work.col(r2).head(n) * work.col(3 + r1).head(n);
+                }
+                lin = 6;
+                // angular velocity
+                for (unsigned int r = 0; r < 3; ++r)
+                {
+                    jacobians.col(outCol + 3 + r).segment(startRow, n).array() =
+                        sign * (T.col(baseCol + r).head(n) * work.col(0).head(n)
+                                + T.col(baseCol + 3 + r).head(n) * work.col(1).head(n)
+                                + T.col(baseCol + 6 + r).head(n) * work.col(2).head(n));
+                }
+            }
+            else if (jointType[joint] != urdf::Joint::PRISMATIC)
+            {
+                continue;
+            }
+
+            // rotate into the base frame with the transposed base rotation
+            for (unsigned int r = 0; r < 3; ++r)
+            {
+                jacobians.col(outCol + r).segment(startRow, n).array() =
+                    sign * (T.col(baseCol + r).head(n) * work.col(lin).head(n)
+                            + T.col(baseCol + 3 + r).head(n) * work.col(lin + 1).head(n)
+                            + T.col(baseCol + 6 + r).head(n) * work.col(lin + 2).head(n));
+            }
+        }
+    }
+    return true;
+}
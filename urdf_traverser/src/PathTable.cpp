@@ -0,0 +1,216 @@
+/**
+ * <ORGANIZATION> = Jennifer Buehler 
+ * <COPYRIGHT HOLDER> = Jennifer Buehler 
+ * 
+ * Copyright (c) 2016 Jennifer Buehler 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <ORGANIZATION> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ------------------------------------------------------------------------------
+ **/
+#include <ros/ros.h>
+#include <urdf_traverser/PathTable.h>
+#include <urdf_traverser/Helpers.h>
+
+#define BOOST_NO_CXX11_SCOPED_ENUMS
+#include <boost/filesystem.hpp>
+#undef BOOST_NO_CXX11_SCOPED_ENUMS
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+using urdf_traverser::helpers::PathTable;
+
+void PathTable::updateCurrentDir()
+{
+    std::string currDir = boost::filesystem::current_path().string();
+    urdf_traverser::helpers::enforceDirectory(currDir, false);
+    currentDir = getPath(currDir).components;
+}
+
+unsigned int PathTable::getComponentId(const std::string& component)
+{
+    std::map<std::string, unsigned int>::iterator it = componentIds.find(component);
+    if (it != componentIds.end()) return it->second;
+    componentIds.insert(std::make_pair(component, components.size()));
+    components.push_back(component);
+    return components.size() - 1;
+}
+
+const PathTable::Path& PathTable::getPath(const std::string& path)
+{
+    std::map<std::string, Path>::iterator it = paths.find(path);
+    if (it != paths.end()) return it->second;
+
+    Path p;
+    p.isDirectory = urdf_traverser::helpers::isDirectoryPath(path);
+    p.isRelative = path.empty() || (path[0] != '/');
+    size_t start = 0;
+    while (start < path.size())
+    {
+        size_t end = path.find('/', start);
+        if (end == std::string::npos) end = path.size();
+        if ((end > start) && !((end == start + 1) && (path[start] == '.')))
+            p.components.push_back(getComponentId(path.substr(start, end - start)));
+        start = end + 1;
+    }
+    return paths.insert(std::make_pair(path, p)).first->second;
+}
+
+std::string PathTable::join(const Path& path, size_t from, size_t to) const
+{
+    std::string ret;
+    for (size_t i = from; i < to; ++i)
+    {
+        if (i > from) ret.append(1, '/');
+        ret.append(components[getComponent(path, i)]);
+    }
+    return ret;
+}
+
+size_t PathTable::getCommonLength(const Path& path1, size_t len1, const Path& path2, size_t len2) const
+{
+    size_t len = std::min(len1, len2);
+    size_t commonLength = 0;
+    while ((commonLength < len) && (getComponent(path1, commonLength) == getComponent(path2, commonLength)))
+        ++commonLength;
+    return commonLength;
+}
+
+size_t PathTable::getCommonParentLength(const Path& path1, const Path& path2) const
+{
+    // numDirectories() in Helpers.cpp counts the elements of the path as given, which include
+    // the root and the '.' after a trailing separator, minus one.
+    size_t num1 = path1.components.size() + (path1.isRelative ? 0 : 1) + (path1.isDirectory ? 1 : 0);
+    size_t num2 = path2.components.size() + (path2.isRelative ? 0 : 1) + (path2.isDirectory ? 1 : 0);
+    const Path& longer = (num2 > num1) ? path2 : path1;
+    const Path& other = (num2 > num1) ? path1 : path2;
+    return getCommonLength(longer, getDirectoryLength(longer), other, numComponents(other));
+}
+
+bool PathTable::getParentPath(const Path& path, size_t commonLength, bool relative, std::string& result) const
+{
+    if (!relative)
+    {
+        result = "/" + join(path, 0, commonLength);
+        urdf_traverser::helpers::enforceDirectory(result, false);
+        return true;
+    }
+    // the common parent of relative paths is relative to the current directory as well
+    if (commonLength < currentDir.size()) return false;
+    if (commonLength == currentDir.size())
+    {
+        result = ".";
+        return true;
+    }
+    result = join(path, currentDir.size(), commonLength);
+    urdf_traverser::helpers::enforceDirectory(result, false);
+    return true;
+}
+
+bool PathTable::getCommonParentPath(const std::set<std::string>& allFiles, std::string& result)
+{
+    if (allFiles.empty())
+    {
+        ROS_ERROR("Cannot get common path of empty set");
+        return false;
+    }
+    updateCurrentDir();
+
+    std::set<std::string>::const_iterator it = allFiles.begin();
+    const Path& first = getPath(*it);
+    bool anyRelative = first.isRelative;
+    size_t commonLength = getDirectoryLength(first);
+    for (++it; it != allFiles.end(); ++it)
+    {
+        const Path& p = getPath(*it);
+        anyRelative = anyRelative || p.isRelative;
+        commonLength = getCommonLength(first, commonLength, p, getDirectoryLength(p));
+    }
+
+    if (!getParentPath(first, commonLength, anyRelative, result))
+    {
+        ROS_ERROR_STREAM("The common parent path of the relative paths is not within the current directory");
+        return false;
+    }
+    return true;
+}
+
+bool PathTable::getSubdirPath(const std::string& from, const std::string& to, std::string& result)
+{
+    if (!urdf_traverser::helpers::isDirectoryPath(from))
+    {
+        ROS_ERROR_STREAM("Base path (" << from << ") must be a directory");
+        throw std::exception();
+    }
+
+    if (from == to)
+    {
+        result = ".";
+        return true;
+    }
+    updateCurrentDir();
+
+    const Path& f = getPath(from);
+    const Path& t = getPath(to);
+    size_t fromLength = numComponents(f);
+    size_t toLength = numComponents(t);
+    if ((toLength < fromLength) || (getCommonLength(f, fromLength, t, toLength) < fromLength))
+        return false;
+
+    result = join(t, fromLength, toLength);
+    if (t.isDirectory && !result.empty()) result.append(1, '/');
+    return true;
+}
+
+bool PathTable::getRelativeDirectory(const std::string& path, const std::string& relTo, std::string& result)
+{
+    updateCurrentDir();
+    const Path& p = getPath(path);
+    const Path& r = getPath(relTo);
+
+    size_t commonLength = getCommonParentLength(p, r);
+    std::string commonParent;
+    if (!getParentPath(p, commonLength, p.isRelative || r.isRelative, commonParent))
+    {
+        ROS_ERROR_STREAM("Directories " << path << " and " << relTo << " have no common parent directory.");
+        return false;
+    }
+
+    // go up from the directory of \e relTo to the common parent directory, then down to \e path
+    result.clear();
+    for (size_t i = commonLength; i < getDirectoryLength(r); ++i)
+        result.append("../");
+    if (commonParent == path)
+    {
+        result.append(".");
+        return true;
+    }
+    size_t pathLength = numComponents(p);
+    result.append(join(p, commonLength, pathLength));
+    if (p.isDirectory && (pathLength > commonLength)) result.append(1, '/');
+    return true;
+}
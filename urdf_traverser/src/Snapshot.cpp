@@ -0,0 +1,776 @@
+/**
+ * <ORGANIZATION> = Jennifer Buehler 
+ * <COPYRIGHT HOLDER> = Jennifer Buehler 
+ * 
+ * Copyright (c) 2016 Jennifer Buehler 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <ORGANIZATION> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ------------------------------------------------------------------------------
+ **/
+#include <ros/ros.h>
+#include <urdf_traverser/Snapshot.h>
+
+#include <stdint.h>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+using urdf_traverser::LinkPtr;
+using urdf_traverser::JointPtr;
+using urdf_traverser::VisualPtr;
+using urdf_traverser::CollisionPtr;
+using urdf_traverser::GeometryPtr;
+using urdf_traverser::InertialPtr;
+using urdf_traverser::MaterialPtr;
+
+// Identifies the snapshot format. The version has to be increased when the format changes.
+#define SNAPSHOT_MAGIC "URDFSNAP"
+#define SNAPSHOT_VERSION 1
+// written in the byte order of the machine, to detect snapshots from machines with another byte order
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+
+// how a visual refers to its material
+#define SNAPSHOT_NO_MATERIAL 0
+#define SNAPSHOT_MODEL_MATERIAL 1
+#define SNAPSHOT_OWN_MATERIAL 2
+
+/**
+ * Appends values to the snapshot buffer
+ */
+class SnapshotWriter
+{
+public:
+    explicit SnapshotWriter(std::string& _buffer):
+        buffer(_buffer) {}
+
+    template<typename T>
+    void write(const T& value)
+    {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void writeString(const std::string& str)
+    {
+        write<uint32_t>(str.size());
+        buffer.append(str);
+    }
+
+    void writeVector3(const urdf::Vector3& v)
+    {
+        write(v.x);
+        write(v.y);
+        write(v.z);
+    }
+
+    void writePose(const urdf::Pose& p)
+    {
+        writeVector3(p.position);
+        write(p.rotation.x);
+        write(p.rotation.y);
+        write(p.rotation.z);
+        write(p.rotation.w);
+    }
+
+private:
+    std::string& buffer;
+};
+
+/**
+ * Reads values from the snapshot buffer. All read functions return false
+ * if the end of the buffer is reached.
+ */
+class SnapshotReader
+{
+public:
+    SnapshotReader(const std::string& buffer, size_t start):
+        pos(buffer.data() + start),
+        end(buffer.data() + buffer.size()) {}
+
+    template<typename T>
+    bool read(T& value)
+    {
+        if (static_cast<size_t>(end - pos) < sizeof(T)) return false;
+        std::memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    bool readString(std::string& str)
+    {
+        uint32_t size;
+        if (!read(size) || (static_cast<size_t>(end - pos) < size)) return false;
+        str.assign(pos, size);
+        pos += size;
+        return true;
+    }
+
+    bool readVector3(urdf::Vector3& v)
+    {
+        return read(v.x) && read(v.y) && read(v.z);
+    }
+
+    bool readPose(urdf::Pose& p)
+    {
+        return readVector3(p.position) && read(p.rotation.x) && read(p.rotation.y)
+               && read(p.rotation.z) && read(p.rotation.w);
+    }
+
+    bool atEnd() const
+    {
+        return pos == end;
+    }
+
+private:
+    const char * pos;
+    const char * end;
+};
+
+
+void writeMaterial(const urdf::Material& material, SnapshotWriter& w)
+{
+    w.writeString(material.name);
+    w.writeString(material.texture_filename);
+    w.write(material.color.r);
+    w.write(material.color.g);
+    w.write(material.color.b);
+    w.write(material.color.a);
+}
+
+bool readMaterial(SnapshotReader& r, MaterialPtr& material)
+{
+    material.reset(new urdf::Material());
+    return r.readString(material->name) && r.readString(material->texture_filename)
+           && r.read(material->color.r) && r.read(material->color.g)
+           && r.read(material->color.b) && r.read(material->color.a);
+}
+
+void writeGeometry(const GeometryPtr& geometry, SnapshotWriter& w)
+{
+    int32_t type = geometry ? geometry->type : -1;
+    w.write(type);
+    switch (type)
+    {
+    case urdf::Geometry::SPHERE:
+    {
+        w.write(static_cast<const urdf::Sphere&>(*geometry).radius);
+        break;
+    }
+    case urdf::Geometry::BOX:
+    {
+        w.writeVector3(static_cast<const urdf::Box&>(*geometry).dim);
+        break;
+    }
+    case urdf::Geometry::CYLINDER:
+    {
+        const urdf::Cylinder& cylinder = static_cast<const urdf::Cylinder&>(*geometry);
+        w.write(cylinder.radius);
+        w.write(cylinder.length);
+        break;
+    }
+    case urdf::Geometry::MESH:
+    {
+        const urdf::Mesh& mesh = static_cast<const urdf::Mesh&>(*geometry);
+        w.writeString(mesh.filename);
+        w.writeVector3(mesh.scale);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+bool readGeometry(SnapshotReader& r, GeometryPtr& geometry)
+{
+    int32_t type;
+    if (!r.read(type)) return false;
+    switch (type)
+    {
+    case -1:
+    {
+        geometry.reset();
+        return true;
+    }
+    case urdf::Geometry::SPHERE:
+    {
+        urdf_traverser::SpherePtr sphere(new urdf::Sphere());
+        sphere->type = urdf::Geometry::SPHERE;
+        geometry = sphere;
+        return r.read(sphere->radius);
+    }
+    case urdf::Geometry::BOX:
+    {
+        urdf_traverser::BoxPtr box(new urdf::Box());
+        box->type = urdf::Geometry::BOX;
+        geometry = box;
+        return r.readVector3(box->dim);
+    }
+    case urdf::Geometry::CYLINDER:
+    {
+        urdf_traverser::CylinderPtr cylinder(new urdf::Cylinder());
+        cylinder->type = urdf::Geometry::CYLINDER;
+        geometry = cylinder;
+        return r.read(cylinder->radius) && r.read(cylinder->length);
+    }
+    case urdf::Geometry::MESH:
+    {
+        urdf_traverser::MeshPtr mesh(new urdf::Mesh());
+        mesh->type = urdf::Geometry::MESH;
+        geometry = mesh;
+        return r.readString(mesh->filename) && r.readVector3(mesh->scale);
+    }
+    default:
+        ROS_ERROR("Snapshot: Unknown geometry type %i", type);
+        return false;
+    }
+}
+
+void writeVisual(const urdf::Model& model, const urdf::Visual& visual, SnapshotWriter& w)
+{
+    w.writeString(visual.name);
+    w.writePose(visual.origin);
+    writeGeometry(visual.geometry, w);
+    w.writeString(visual.material_name);
+    // keep the material shared with the model if it is the model's material
+    std::map<std::string, MaterialPtr>::const_iterator mIt = model.materials_.find(visual.material_name);
+    if (!visual.material)
+    {
+        w.write<uint8_t>(SNAPSHOT_NO_MATERIAL);
+    }
+    else if ((mIt != model.materials_.end()) && (mIt->second == visual.material))
+    {
+        w.write<uint8_t>(SNAPSHOT_MODEL_MATERIAL);
+    }
+    else
+    {
+        w.write<uint8_t>(SNAPSHOT_OWN_MATERIAL);
+        writeMaterial(*visual.material, w);
+    }
+}
+
+bool readVisual(SnapshotReader& r, const urdf::Model& model, VisualPtr& visual)
+{
+    visual.reset(new urdf::Visual());
+    uint8_t materialType;
+    if (!r.readString(visual->name) || !r.readPose(visual->origin) || !readGeometry(r, visual->geometry)
+            || !r.readString(visual->material_name) || !r.read(materialType))
+    {
+        return false;
+    }
+    if (materialType == SNAPSHOT_MODEL_MATERIAL)
+    {
+        std::map<std::string, MaterialPtr>::const_iterator mIt = model.materials_.find(visual->material_name);
+        if (mIt == model.materials_.end())
+        {
+            ROS_ERROR("Snapshot: Material %s not found", visual->material_name.c_str());
+            return false;
+        }
+        visual->material = mIt->second;
+    }
+    else if (materialType == SNAPSHOT_OWN_MATERIAL)
+    {
+        return readMaterial(r, visual->material);
+    }
+    return true;
+}
+
+void writeCollision(const urdf::Collision& collision, SnapshotWriter& w)
+{
+    w.writeString(collision.name);
+    w.writePose(collision.origin);
+    writeGeometry(collision.geometry, w);
+}
+
+bool readCollision(SnapshotReader& r, CollisionPtr& collision)
+{
+    collision.reset(new urdf::Collision());
+    return r.readString(collision->name) && r.readPose(collision->origin) && readGeometry(r, collision->geometry);
+}
+
+/**
+ * Writes the index of \e element in \e array, or -1 if \e element is NULL. If the element is
+ * not in the array, it is written after index -2 with \e writeElement.
+ */
+template<typename ElementPtr, typename WriteFunction>
+void writeElementIndex(const ElementPtr& element, const std::vector<ElementPtr>& array,
+                       const WriteFunction& writeElement, SnapshotWriter& w)
+{
+    int32_t idx = -1;
+    if (element)
+    {
+        idx = -2;
+        for (unsigned int i = 0; i < array.size(); ++i)
+        {
+            if (array[i] == element)
+            {
+                idx = i;
+                break;
+            }
+        }
+    }
+    w.write(idx);
+    if (idx == -2) writeElement(*element);
+}
+
+/**
+ * Reads what has been written with writeElementIndex()
+ */
+template<typename ElementPtr, typename ReadFunction>
+bool readElementIndex(SnapshotReader& r, const std::vector<ElementPtr>& array,
+                      const ReadFunction& readElement, ElementPtr& element)
+{
+    int32_t idx;
+    if (!r.read(idx)) return false;
+    element.reset();
+    if (idx == -2) return readElement(element);
+    if (idx == -1) return true;
+    if ((idx < 0) || (idx >= static_cast<int32_t>(array.size()))) return false;
+    element = array[idx];
+    return true;
+}
+
+void writeInertial(const InertialPtr& inertial, SnapshotWriter& w)
+{
+    w.write<uint8_t>(inertial ? 1 : 0);
+    if (!inertial) return;
+    w.writePose(inertial->origin);
+    w.write(inertial->mass);
+    w.write(inertial->ixx);
+    w.write(inertial->ixy);
+    w.write(inertial->ixz);
+    w.write(inertial->iyy);
+    w.write(inertial->iyz);
+    w.write(inertial->izz);
+}
+
+bool readInertial(SnapshotReader& r, InertialPtr& inertial)
+{
+    uint8_t hasInertial;
+    if (!r.read(hasInertial)) return false;
+    inertial.reset();
+    if (!hasInertial) return true;
+    inertial.reset(new urdf::Inertial());
+    return r.readPose(inertial->origin) && r.read(inertial->mass)
+           && r.read(inertial->ixx) && r.read(inertial->ixy) && r.read(inertial->ixz)
+           && r.read(inertial->iyy) && r.read(inertial->iyz) && r.read(inertial->izz);
+}
+
+/**
+ * Writes a flag whether \e value is set, followed by the value if it is.
+ */
+void writeOptional(const shr_lib::shared_ptr<double>& value, SnapshotWriter& w)
+{
+    w.write<uint8_t>(value ? 1 : 0);
+    if (value) w.write(*value);
+}
+
+bool readOptional(SnapshotReader& r, shr_lib::shared_ptr<double>& value)
+{
+    uint8_t isSet;
+    if (!r.read(isSet)) return false;
+    value.reset();
+    if (!isSet) return true;
+    value.reset(new double(0));
+    return r.read(*value);
+}
+
+void writeJoint(const urdf::Joint& joint, SnapshotWriter& w)
+{
+    w.writeString(joint.name);
+    w.write<int32_t>(joint.type);
+    w.writeString(joint.parent_link_name);
+    w.writeString(joint.child_link_name);
+    w.writePose(joint.parent_to_joint_origin_transform);
+    w.writeVector3(joint.axis);
+
+    // the optional properties are written after a flag whether they are set
+    w.write<uint8_t>(joint.limits ? 1 : 0);
+    if (joint.limits)
+    {
+        w.write(joint.limits->lower);
+        w.write(joint.limits->upper);
+        w.write(joint.limits->effort);
+        w.write(joint.limits->velocity);
+    }
+    w.write<uint8_t>(joint.dynamics ? 1 : 0);
+    if (joint.dynamics)
+    {
+        w.write(joint.dynamics->damping);
+        w.write(joint.dynamics->friction);
+    }
+    w.write<uint8_t>(joint.safety ? 1 : 0);
+    if (joint.safety)
+    {
+        w.write(joint.safety->soft_upper_limit);
+        w.write(joint.safety->soft_lower_limit);
+        w.write(joint.safety->k_position);
+        w.write(joint.safety->k_velocity);
+    }
+    w.write<uint8_t>(joint.calibration ? 1 : 0);
+    if (joint.calibration)
+    {
+        w.write(joint.calibration->reference_position);
+        writeOptional(joint.calibration->rising, w);
+        writeOptional(joint.calibration->falling, w);
+    }
+    w.write<uint8_t>(joint.mimic ? 1 : 0);
+    if (joint.mimic)
+    {
+        w.writeString(joint.mimic->joint_name);
+        w.write(joint.mimic->multiplier);
+        w.write(joint.mimic->offset);
+    }
+}
+
+bool readJoint(SnapshotReader& r, JointPtr& joint)
+{
+    joint.reset(new urdf::Joint());
+    int32_t type;
+    if (!r.readString(joint->name) || !r.read(type) || !r.readString(joint->parent_link_name)
+            || !r.readString(joint->child_link_name) || !r.readPose(joint->parent_to_joint_origin_transform)
+            || !r.readVector3(joint->axis))
+    {
+        return false;
+    }
+    joint->type = static_cast<decltype(joint->type)>(type);
+
+    uint8_t isSet;
+    if (!r.read(isSet)) return false;
+    if (isSet)
+    {
+        joint->limits.reset(new urdf::JointLimits());
+        if (!r.read(joint->limits->lower) || !r.read(joint->limits->upper)
+                || !r.read(joint->limits->effort) || !r.read(joint->limits->velocity))
+        {
+            return false;
+        }
+    }
+    if (!r.read(isSet)) return false;
+    if (isSet)
+    {
+        joint->dynamics.reset(new urdf::JointDynamics());
+        if (!r.read(joint->dynamics->damping) || !r.read(joint->dynamics->friction)) return false;
+    }
+    if (!r.read(isSet)) return false;
+    if (isSet)
+    {
+        joint->safety.reset(new urdf::JointSafety());
+        if (!r.read(joint->safety->soft_upper_limit) || !r.read(joint->safety->soft_lower_limit)
+                || !r.read(joint->safety->k_position) || !r.read(joint->safety->k_velocity))
+        {
+            return false;
+        }
+    }
+    if (!r.read(isSet)) return false;
+    if (isSet)
+    {
+        joint->calibration.reset(new urdf::JointCalibration());
+        if (!r.read(joint->calibration->reference_position) || !readOptional(r, joint->calibration->rising)
+                || !readOptional(r, joint->calibration->falling))
+        {
+            return false;
+        }
+    }
+    if (!r.read(isSet)) return false;
+    if (isSet)
+    {
+        joint->mimic.reset(new urdf::JointMimic());
+        if (!r.readString(joint->mimic->joint_name) || !r.read(joint->mimic->multiplier)
+                || !r.read(joint->mimic->offset))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Functor to write a visual which is not in the visual array of the link
+ */
+struct VisualWriter
+{
+    VisualWriter(const urdf::Model& _model, SnapshotWriter& _w):
+        model(_model),
+        w(_w) {}
+    void operator()(const urdf::Visual& visual) const
+    {
+        writeVisual(model, visual, w);
+    }
+    const urdf::Model& model;
+    SnapshotWriter& w;
+};
+
+struct VisualReader
+{
+    VisualReader(const urdf::Model& _model, SnapshotReader& _r):
+        model(_model),
+        r(_r) {}
+    bool operator()(VisualPtr& visual) const
+    {
+        return readVisual(r, model, visual);
+    }
+    const urdf::Model& model;
+    SnapshotReader& r;
+};
+
+struct CollisionWriter
+{
+    explicit CollisionWriter(SnapshotWriter& _w):
+        w(_w) {}
+    void operator()(const urdf::Collision& collision) const
+    {
+        writeCollision(collision, w);
+    }
+    SnapshotWriter& w;
+};
+
+struct CollisionReader
+{
+    explicit CollisionReader(SnapshotReader& _r):
+        r(_r) {}
+    bool operator()(CollisionPtr& collision) const
+    {
+        return readCollision(r, collision);
+    }
+    SnapshotReader& r;
+};
+
+void writeLink(const urdf::Model& model, const urdf::Link& link, SnapshotWriter& w)
+{
+    w.writeString(link.name);
+    writeInertial(link.inertial, w);
+
+    w.write<uint32_t>(link.visual_array.size());
+    for (unsigned int i = 0; i < link.visual_array.size(); ++i)
+    {
+        writeVisual(model, *link.visual_array[i], w);
+    }
+    writeElementIndex(link.visual, link.visual_array, VisualWriter(model, w), w);
+
+    w.write<uint32_t>(link.collision_array.size());
+    for (unsigned int i = 0; i < link.collision_array.size(); ++i)
+    {
+        writeCollision(*link.collision_array[i], w);
+    }
+    writeElementIndex(link.collision, link.collision_array, CollisionWriter(w), w);
+
+    // The child joints in the order of the link's children. Links which have been detached
+    // from the tree (e.g. when joining fixed links) may still refer to joints which have been
+    // moved to another link, so only the joints which have this link as parent are written.
+    uint32_t numChildJoints = 0;
+    for (unsigned int i = 0; i < link.child_joints.size(); ++i)
+    {
+        if (link.child_joints[i]->parent_link_name == link.name) ++numChildJoints;
+    }
+    w.write<uint32_t>(numChildJoints);
+    for (unsigned int i = 0; i < link.child_joints.size(); ++i)
+    {
+        if (link.child_joints[i]->parent_link_name == link.name) w.writeString(link.child_joints[i]->name);
+    }
+}
+
+bool readLink(SnapshotReader& r, const urdf::Model& model, LinkPtr& link, std::vector<std::string>& childJoints)
+{
+    link.reset(new urdf::Link());
+    if (!r.readString(link->name) || !readInertial(r, link->inertial)) return false;
+
+    uint32_t num;
+    if (!r.read(num)) return false;
+    link->visual_array.resize(num);
+    for (unsigned int i = 0; i < num; ++i)
+    {
+        if (!readVisual(r, model, link->visual_array[i])) return false;
+    }
+    if (!readElementIndex(r, link->visual_array, VisualReader(model, r), link->visual)) return false;
+
+    if (!r.read(num)) return false;
+    link->collision_array.resize(num);
+    for (unsigned int i = 0; i < num; ++i)
+    {
+        if (!readCollision(r, link->collision_array[i])) return false;
+    }
+    if (!readElementIndex(r, link->collision_array, CollisionReader(r), link->collision)) return false;
+
+    if (!r.read(num)) return false;
+    childJoints.resize(num);
+    for (unsigned int i = 0; i < num; ++i)
+    {
+        if (!r.readString(childJoints[i])) return false;
+    }
+    return true;
+}
+
+bool urdf_traverser::writeSnapshot(const urdf::Model& model, const std::string& modelDir, std::string& buffer)
+{
+    if (!model.root_link_)
+    {
+        ROS_ERROR("Snapshot: Model has no root link");
+        return false;
+    }
+
+    buffer.clear();
+    SnapshotWriter w(buffer);
+    buffer.append(SNAPSHOT_MAGIC);
+    w.write<uint32_t>(SNAPSHOT_VERSION);
+    w.write<uint32_t>(SNAPSHOT_BYTE_ORDER);
+    w.writeString(modelDir);
+    w.writeString(model.name_);
+
+    w.write<uint32_t>(model.materials_.size());
+    for (std::map<std::string, MaterialPtr>::const_iterator it = model.materials_.begin();
+            it != model.materials_.end(); ++it)
+    {
+        w.writeString(it->first);
+        writeMaterial(*it->second, w);
+    }
+
+    w.write<uint32_t>(model.joints_.size());
+    for (std::map<std::string, JointPtr>::const_iterator it = model.joints_.begin(); it != model.joints_.end(); ++it)
+    {
+        writeJoint(*it->second, w);
+    }
+
+    w.write<uint32_t>(model.links_.size());
+    for (std::map<std::string, LinkPtr>::const_iterator it = model.links_.begin(); it != model.links_.end(); ++it)
+    {
+        writeLink(model, *it->second, w);
+    }
+
+    w.writeString(model.root_link_->name);
+    return true;
+}
+
+bool urdf_traverser::readSnapshot(const std::string& buffer, urdf::Model& model, std::string& modelDir)
+{
+    const size_t magicSize = std::strlen(SNAPSHOT_MAGIC);
+    if (buffer.compare(0, magicSize, SNAPSHOT_MAGIC) != 0)
+    {
+        ROS_ERROR("Snapshot: Not a snapshot");
+        return false;
+    }
+    SnapshotReader r(buffer, magicSize);
+    uint32_t version, byteOrder;
+    if (!r.read(version) || !r.read(byteOrder) || (version != SNAPSHOT_VERSION) || (byteOrder != SNAPSHOT_BYTE_ORDER))
+    {
+        ROS_ERROR("Snapshot: Wrong version, or written on a machine with different byte order");
+        return false;
+    }
+
+    urdf::Model result;
+    std::string dir;
+    uint32_t num;
+    if (!r.readString(dir) || !r.readString(result.name_) || !r.read(num))
+    {
+        ROS_ERROR("Snapshot: Could not read header");
+        return false;
+    }
+
+    for (unsigned int i = 0; i < num; ++i)
+    {
+        std::string name;
+        MaterialPtr material;
+        if (!r.readString(name) || !readMaterial(r, material))
+        {
+            ROS_ERROR("Snapshot: Could not read material");
+            return false;
+        }
+        result.materials_[name] = material;
+    }
+
+    if (!r.read(num)) return false;
+    for (unsigned int i = 0; i < num; ++i)
+    {
+        JointPtr joint;
+        if (!readJoint(r, joint))
+        {
+            ROS_ERROR("Snapshot: Could not read joint");
+            return false;
+        }
+        result.joints_[joint->name] = joint;
+    }
+
+    if (!r.read(num)) return false;
+    std::vector<std::vector<std::string> > childJoints(num);
+    for (unsigned int i = 0; i < num; ++i)
+    {
+        LinkPtr link;
+        if (!readLink(r, result, link, childJoints[i]))
+        {
+            ROS_ERROR("Snapshot: Could not read link");
+            return false;
+        }
+        result.links_[link->name] = link;
+    }
+
+    std::string rootName;
+    if (!r.readString(rootName) || !r.atEnd())
+    {
+        ROS_ERROR("Snapshot: Could not read root link");
+        return false;
+    }
+
+    // connect the links. They are in the same order as in the snapshot.
+    unsigned int i = 0;
+    for (std::map<std::string, LinkPtr>::iterator it = result.links_.begin(); it != result.links_.end(); ++it, ++i)
+    {
+        LinkPtr& link = it->second;
+        for (std::vector<std::string>::iterator jIt = childJoints[i].begin(); jIt != childJoints[i].end(); ++jIt)
+        {
+            std::map<std::string, JointPtr>::iterator joint = result.joints_.find(*jIt);
+            if (joint == result.joints_.end())
+            {
+                ROS_ERROR("Snapshot: Joint %s not found", jIt->c_str());
+                return false;
+            }
+            if (joint->second->parent_link_name != link->name)
+            {
+                ROS_ERROR("Snapshot: Joint %s is a child of link %s, but its parent is %s", jIt->c_str(),
+                          link->name.c_str(), joint->second->parent_link_name.c_str());
+                return false;
+            }
+            std::map<std::string, LinkPtr>::iterator child = result.links_.find(joint->second->child_link_name);
+            if (child == result.links_.end())
+            {
+                ROS_ERROR("Snapshot: Link %s not found", joint->second->child_link_name.c_str());
+                return false;
+            }
+            child->second->parent_joint = joint->second;
+            child->second->setParent(link);
+            link->child_joints.push_back(joint->second);
+            link->child_links.push_back(child->second);
+        }
+    }
+
+    std::map<std::string, LinkPtr>::iterator root = result.links_.find(rootName);
+    if (root == result.links_.end())
+    {
+        ROS_ERROR("Snapshot: Root link %s not found", rootName.c_str());
+        return false;
+    }
+    result.root_link_ = root->second;
+
+    model = result;
+    modelDir = dir;
+    return true;
+}
@@ -0,0 +1,241 @@
+/**
+ * <ORGANIZATION> = Jennifer Buehler 
+ * <COPYRIGHT HOLDER> = Jennifer Buehler 
+ * 
+ * Copyright (c) 2016 Jennifer Buehler 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <ORGANIZATION> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ------------------------------------------------------------------------------
+ **/
+#include <ros/ros.h>
+#include <urdf_traverser/TopologyIndex.h>
+#include <urdf_traverser/Functions.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <algorithm>
+
+using urdf_traverser::TopologyIndex;
+
+const int TopologyIndex::INVALID_ID;
+
+void TopologyIndex::clear()
+{
+    linkIds.clear();
+    jointIds.clear();
+    links.clear();
+    joints.clear();
+    rootLink = INVALID_ID;
+    linkParentLink.clear();
+    linkParentJoint.clear();
+    jointParentLink.clear();
+    jointChildLink.clear();
+    childOffsets.clear();
+    childLinks.clear();
+    childJoints.clear();
+    linkDepth.clear();
+    linkEnter.clear();
+    linkExit.clear();
+    rootTransforms.clear();
+    ancestors.clear();
+    numAncestorLevels = 0;
+}
+
+bool TopologyIndex::build(const urdf::Model& model)
+{
+    clear();
+
+    unsigned int nLinks = model.links_.size();
+    unsigned int nJoints = model.joints_.size();
+
+    links.reserve(nLinks);
+    linkIds.reserve(nLinks);
+    for (std::map<std::string, LinkPtr>::const_iterator it = model.links_.begin();
+            it != model.links_.end(); ++it)
+    {
+        linkIds[it->first] = links.size();
+        links.push_back(it->second);
+    }
+
+    joints.reserve(nJoints);
+    jointIds.reserve(nJoints);
+    jointParentLink.reserve(nJoints);
+    jointChildLink.reserve(nJoints);
+    for (std::map<std::string, JointPtr>::const_iterator it = model.joints_.begin();
+            it != model.joints_.end(); ++it)
+    {
+        JointPtr joint = it->second;
+        int parentId = getLinkId(joint->parent_link_name);
+        int childId = getLinkId(joint->child_link_name);
+        if ((parentId == INVALID_ID) || (childId == INVALID_ID))
+        {
+            ROS_ERROR("TopologyIndex: Joint %s references links which are not in the model", joint->name.c_str());
+            clear();
+            return false;
+        }
+        jointIds[it->first] = joints.size();
+        joints.push_back(joint);
+        jointParentLink.push_back(parentId);
+        jointChildLink.push_back(childId);
+    }
+
+    linkParentLink.assign(nLinks, INVALID_ID);
+    linkParentJoint.assign(nLinks, INVALID_ID);
+    childOffsets.reserve(nLinks + 1);
+    childLinks.reserve(nJoints);
+    childJoints.reserve(nJoints);
+    for (unsigned int i = 0; i < nLinks; ++i)
+    {
+        const LinkPtr& link = links[i];
+        if (link->parent_joint)
+        {
+            linkParentJoint[i] = getJointId(link->parent_joint->name);
+            LinkPtr parent = link->getParent();
+            if (parent) linkParentLink[i] = getLinkId(parent->name);
+        }
+
+        childOffsets.push_back(childLinks.size());
+        for (std::vector<LinkPtr>::const_iterator child = link->child_links.begin();
+                child != link->child_links.end(); ++child)
+        {
+            if (!*child)
+            {
+                ROS_ERROR("TopologyIndex: Link %s has a null child", link->name.c_str());
+                clear();
+                return false;
+            }
+            int childId = getLinkId((*child)->name);
+            int childJointId = INVALID_ID;
+            if ((*child)->parent_joint) childJointId = getJointId((*child)->parent_joint->name);
+            if ((childId == INVALID_ID) || (childJointId == INVALID_ID))
+            {
+                ROS_ERROR("TopologyIndex: Child %s of link %s is not properly connected in the model",
+                          (*child)->name.c_str(), link->name.c_str());
+                clear();
+                return false;
+            }
+            childLinks.push_back(childId);
+            childJoints.push_back(childJointId);
+        }
+    }
+    childOffsets.push_back(childLinks.size());
+
+    if (model.getRoot()) rootLink = getLinkId(model.getRoot()->name);
+
+    buildAncestors();
+    return true;
+}
+
+void TopologyIndex::buildAncestors()
+{
+    const unsigned int nLinks = links.size();
+    linkDepth.assign(nLinks, -1);
+    linkEnter.assign(nLinks, 0);
+    linkExit.assign(nLinks, 0);
+    rootTransforms.assign(nLinks, EigenTransform::Identity());
+
+    // The tree is given by the child links, starting from the root link of the model.
+    // Links which can't be reached from there have been detached from the tree but are
+    // still in the model. They are the roots of separate trees, and references to links
+    // which have been visited already (e.g. old child links of a detached link) are skipped.
+    std::vector<int> treeParent(nLinks, INVALID_ID);
+    std::vector<int> roots;
+    roots.reserve(nLinks + 1);
+    if (rootLink != INVALID_ID) roots.push_back(rootLink);
+    for (unsigned int i = 0; i < nLinks; ++i)
+    {
+        roots.push_back(i);
+    }
+
+    // depth-first traversal from all roots.
+    // Stack entries are the link and the index of the next child to visit.
+    std::vector<std::pair<int, unsigned int> > stack;
+    unsigned int counter = 0;
+    int maxDepth = 0;
+    for (std::vector<int>::const_iterator root = roots.begin(); root != roots.end(); ++root)
+    {
+        if (linkDepth[*root] >= 0) continue;
+        linkDepth[*root] = 0;
+        linkEnter[*root] = counter++;
+        stack.push_back(std::make_pair(*root, 0u));
+        while (!stack.empty())
+        {
+            const int link = stack.back().first;
+            const unsigned int next = stack.back().second;
+            if (next == numChildren(link))
+            {
+                linkExit[link] = counter++;
+                stack.pop_back();
+                continue;
+            }
+            ++stack.back().second;
+            const int child = getChildLinkId(link, next);
+            if (linkDepth[child] >= 0) continue;
+            treeParent[child] = link;
+            linkDepth[child] = linkDepth[link] + 1;
+            if (linkDepth[child] > maxDepth) maxDepth = linkDepth[child];
+            linkEnter[child] = counter++;
+            rootTransforms[child] = rootTransforms[link] * urdf_traverser::getTransform(joints[getChildJointId(link, next)]);
+            stack.push_back(std::make_pair(child, 0u));
+        }
+    }
+
+    numAncestorLevels = 1;
+    while ((1 << numAncestorLevels) <= maxDepth) ++numAncestorLevels;
+    ancestors.resize(numAncestorLevels * nLinks);
+    std::copy(treeParent.begin(), treeParent.end(), ancestors.begin());
+    for (unsigned int k = 1; k < numAncestorLevels; ++k)
+    {
+        const int* prev = &ancestors[(k - 1) * nLinks];
+        int* curr = &ancestors[k * nLinks];
+        for (unsigned int i = 0; i < nLinks; ++i)
+        {
+            curr[i] = (prev[i] == INVALID_ID) ? INVALID_ID : prev[prev[i]];
+        }
+    }
+}
+
+int TopologyIndex::getCommonAncestor(int linkA, int linkB) const
+{
+    if (isAncestor(linkA, linkB)) return linkA;
+    if (isAncestor(linkB, linkA)) return linkB;
+    // go up from linkA as long as the link is not an ancestor of linkB
+    const unsigned int nLinks = links.size();
+    for (int k = numAncestorLevels - 1; k >= 0; --k)
+    {
+        const int up = ancestors[k * nLinks + linkA];
+        if ((up != INVALID_ID) && !isAncestor(up, linkB)) linkA = up;
+    }
+    return ancestors[linkA];
+}
+
+bool TopologyIndex::getTransform(int fromLinkId, int toLinkId, EigenTransform& result) const
+{
+    if (getCommonAncestor(fromLinkId, toLinkId) == INVALID_ID) return false;
+    // the transforms are rigid, so the inverse can be computed from the transposed rotation
+    result = rootTransforms[fromLinkId].inverse(Eigen::Isometry) * rootTransforms[toLinkId];
+    return true;
+}
@@ -34,6 +34,7 @@
 #include <urdf_traverser/PrintModel.h>
 #include <urdf_traverser/JointNames.h>
 #include <urdf_traverser/DependencyOrderedJoints.h>
+#include <urdf_traverser/Snapshot.h>
 
 #include <string>
 #include <ros/ros.h>
@@ -48,6 +49,7 @@
 #define RAD_TO_DEG 180/M_PI
 
 using urdf_traverser::UrdfTraverser;
+using urdf_traverser::TopologyIndex;
 
 std::string UrdfTraverser::getRootLinkName() const
 {
@@ -94,8 +96,7 @@ bool UrdfTraverser::getJointNames(const std::string& fromLink,
     }
 
     // get root link
-    LinkPtr root_link;
-    this->model->getLink(rootLink, root_link);
+    LinkPtr root_link = getLink(rootLink);
     if (!root_link)
     {
         ROS_ERROR("no root link %s", fromLink.c_str());
@@ -131,20 +132,25 @@ int UrdfTraverser::getChildJoint(const JointPtr& joint, JointPtr& child)
 
 urdf_traverser::LinkPtr UrdfTraverser::getChildLink(const JointConstPtr& joint)
 {
-    LinkPtr childLink;
-    model->getLink(joint->child_link_name, childLink);
-    return childLink;
+    return getLink(joint->child_link_name);
 }
 
 urdf_traverser::LinkConstPtr UrdfTraverser::readChildLink(const JointConstPtr& joint) const
 {
-    LinkPtr childLink;
-    model->getLink(joint->child_link_name, childLink);
-    return childLink;
+    return readLink(joint->child_link_name);
 }
 
 urdf_traverser::JointPtr UrdfTraverser::getParentJoint(const JointConstPtr& joint)
 {
+    TopologyIndexConstPtr idx = getTopology();
+    if (idx)
+    {
+        int parentId = idx->getLinkId(joint->parent_link_name);
+        if (parentId == TopologyIndex::INVALID_ID) return JointPtr();
+        int parentJointId = idx->getParentJointId(parentId);
+        if (parentJointId == TopologyIndex::INVALID_ID) return JointPtr();
+        return idx->getJoint(parentJointId);
+    }
     LinkConstPtr parentLink = model->getLink(joint->parent_link_name);
     if (!parentLink) return JointPtr();
     return parentLink->parent_joint;
@@ -152,11 +158,105 @@ urdf_traverser::JointPtr UrdfTraverser::getParentJoint(const JointConstPtr& join
 
 urdf_traverser::JointConstPtr UrdfTraverser::readParentJoint(const JointConstPtr& joint) const
 {
+    if (topology)
+    {
+        int parentId = topology->getLinkId(joint->parent_link_name);
+        if (parentId == TopologyIndex::INVALID_ID) return JointPtr();
+        int parentJointId = topology->getParentJointId(parentId);
+        if (parentJointId == TopologyIndex::INVALID_ID) return JointPtr();
+        return topology->getJoint(parentJointId);
+    }
     LinkConstPtr parentLink = model->getLink(joint->parent_link_name);
     if (!parentLink) return JointPtr();
     return parentLink->parent_joint;
 }
 
+bool UrdfTraverser::isChildOf(const std::string& parentName, const std::string& childName)
+{
+    TopologyIndexConstPtr index = getTopology();
+    if (index)
+    {
+        int parentId = index->getLinkId(parentName);
+        int childId = index->getLinkId(childName);
+        if ((parentId == TopologyIndex::INVALID_ID) || (childId == TopologyIndex::INVALID_ID)) return false;
+        return index->getParentLinkId(childId) == parentId;
+    }
+    LinkConstPtr parent = readLink(parentName);
+    LinkConstPtr child = readLink(childName);
+    if (!parent || !child) return false;
+    return urdf_traverser::isChildOf(parent, child);
+}
+
+bool UrdfTraverser::isChildJointOf(const std::string& parentName, const std::string& jointName)
+{
+    TopologyIndexConstPtr index = getTopology();
+    if (index)
+    {
+        int parentId = index->getLinkId(parentName);
+        int jointId = index->getJointId(jointName);
+        if ((parentId == TopologyIndex::INVALID_ID) || (jointId == TopologyIndex::INVALID_ID)) return false;
+        return index->getJointParentLinkId(jointId) == parentId;
+    }
+    LinkConstPtr parent = readLink(parentName);
+    JointConstPtr joint = readJoint(jointName);
+    if (!parent || !joint) return false;
+    return urdf_traverser::isChildJointOf(parent, joint);
+}
+
+bool UrdfTraverser::getTransform(const std::string& fromLink, const std::string& toLink, EigenTransform& result)
+{
+    TopologyIndexConstPtr index = getTopology();
+    if (index)
+    {
+        int fromId = index->getLinkId(fromLink);
+        int toId = index->getLinkId(toLink);
+        if ((fromId == TopologyIndex::INVALID_ID) || (toId == TopologyIndex::INVALID_ID))
+        {
+            ROS_ERROR("Links %s and/or %s not found", fromLink.c_str(), toLink.c_str());
+            return false;
+        }
+        if (!index->getTransform(fromId, toId, result))
+        {
+            ROS_ERROR("Links %s and %s are not connected", fromLink.c_str(), toLink.c_str());
+            return false;
+        }
+        return true;
+    }
+    LinkConstPtr link1 = readLink(fromLink);
+    LinkConstPtr link2 = readLink(toLink);
+    if (!link1 || !link2)
+    {
+        ROS_ERROR("Links %s and/or %s not found", fromLink.c_str(), toLink.c_str());
+        return false;
+    }
+    if ((link1 != link2) && urdf_traverser::getChain(link1, link2).empty()) return false;
+    result = urdf_traverser::getTransform(link1, link2);
+    return true;
+}
+
+void UrdfTraverser::setUseTopologyIndex(bool flag)
+{
+    useTopologyIndex = flag;
+    if (!useTopologyIndex) invalidateTopology();
+}
+
+urdf_traverser::TopologyIndexConstPtr UrdfTraverser::getTopology()
+{
+    if (!useTopologyIndex || topologyFailed) return TopologyIndexConstPtr();
+    if (!topology)
+    {
+        TopologyIndexPtr newIndex(new TopologyIndex());
+        if (!newIndex->build(*model))
+        {
+            ROS_ERROR("Could not build topology index of the model");
+            topologyFailed = true;
+            return TopologyIndexConstPtr();
+        }
+        topology = newIndex;
+    }
+    return topology;
+}
+
 
 
 bool UrdfTraverser::hasChildLink(const LinkConstPtr& link, const std::string& childName) const
@@ -182,52 +282,34 @@ int UrdfTraverser::traverseTreeTopDown(const std::string& linkName, boost::funct
     return traverseTreeTopDown(link, link_cb, params, includeLink, 0);
 }
 
-int UrdfTraverser::traverseTreeTopDown(const LinkPtr& link, boost::function< int(RecursionParamsPtr&)> link_cb,
-                                       RecursionParamsPtr& params, bool includeLink, unsigned int level)
+/**
+ * Visitor for the templated traversals which calls a boost::function callback.
+ * Used to implement the callback-based traversal functions.
+ */
+class CallbackVisitor
 {
-    if (includeLink)
-    {
-        params->setParams(link, level);
-        int link_ret = link_cb(params);
-        if (link_ret <= 0)
-        {
-            // stopping traversal
-            return link_ret;
-        }
-    }
+public:
+    CallbackVisitor(boost::function<int(urdf_traverser::RecursionParamsPtr&)>& _link_cb,
+                    urdf_traverser::RecursionParamsPtr& _params):
+        link_cb(_link_cb),
+        params(_params) {}
 
-    level += 1;
-    for (std::vector<LinkPtr>::const_iterator child = link->child_links.begin();
-            child != link->child_links.end(); child++)
+    int operator()(urdf_traverser::RecursionParams& p)
     {
-        LinkPtr childLink = *child;
-        if (childLink)
-        {
-            params->setParams(childLink, level);
-            int link_ret = link_cb(params);
-            if (link_ret <= 0)
-            {
-                // stopping traversal
-                return link_ret;
-            }
-
-            // recurse down the tree
-            int ret = traverseTreeTopDown(childLink, link_cb, params, false, level);
-            if (ret < 0)
-            {
-                ROS_ERROR("Error parsing branch of %s", childLink->name.c_str());
-                return -1;
-            }
-        }
-        else
-        {
-            ROS_ERROR("root link: %s has a null child!", link->name.c_str());
-            return false;
-        }
+        return link_cb(params);
     }
-    return 1;
+private:
+    boost::function<int(urdf_traverser::RecursionParamsPtr&)>& link_cb;
+    urdf_traverser::RecursionParamsPtr& params;
 };
 
+int UrdfTraverser::traverseTreeTopDown(const LinkPtr& link, boost::function< int(RecursionParamsPtr&)> link_cb,
+                                       RecursionParamsPtr& params, bool includeLink, unsigned int level)
+{
+    CallbackVisitor visitor(link_cb, params);
+    return traverseTopDown(link, visitor, *params, includeLink, level);
+}
+
 int UrdfTraverser::traverseTreeBottomUp(const std::string& linkName, boost::function< int(RecursionParamsPtr&)> link_cb,
                                         RecursionParamsPtr& params, bool includeLink)
 {
@@ -237,7 +319,10 @@ int UrdfTraverser::traverseTreeBottomUp(const std::string& linkName, boost::func
         ROS_ERROR_STREAM("Could not get Link " << linkName);
         return -1;
     }
-    return traverseTreeBottomUp(link, link_cb, params, includeLink, 0);
+    int ret = traverseTreeBottomUp(link, link_cb, params, includeLink, 0);
+    // the callbacks may have re-linked the tree
+    invalidateTopology();
+    return ret;
 }
 
 
@@ -245,66 +330,20 @@ int UrdfTraverser::traverseTreeBottomUp(const std::string& linkName, boost::func
 int UrdfTraverser::traverseTreeBottomUp(const LinkPtr& link, boost::function<int(RecursionParamsPtr&)> link_cb,
                                         RecursionParamsPtr& params, bool includeLink, unsigned int level)
 {
-    std::set<std::string> toTraverse;
-    for (unsigned int i = 0; i < link->child_links.size(); ++i)
-    {
-        LinkPtr childLink = link->child_links[i];
-        toTraverse.insert(childLink->name);
-    }
-
-    for (std::set<std::string>::iterator it = toTraverse.begin(); it != toTraverse.end(); ++it)
-    {
-        if (!hasChildLink(link, *it))
-        {
-            ROS_ERROR_STREAM("Consistency: Link " << link->name << " does not have child " << *it << " any more.");
-            return -1;
-        }
-
-        LinkPtr childLink;
-        this->model->getLink(*it, childLink);
-
-        if (childLink)
-        {
-            // ROS_INFO("Traversal into child %s",childLink->name.c_str());
-            // recurse down the tree
-            int travRes = traverseTreeBottomUp(childLink, link_cb, params, true, level + 1);
-            if (travRes == 0)
-            {
-                ROS_INFO("Stopping traversal at %s", childLink->name.c_str());
-                return 0;
-            }
-            else if (travRes < 0)
-            {
-                ROS_ERROR("Error parsing branch of %s", childLink->name.c_str());
-                return -1;
-            }
-            // childLink = params->result;
-        }
-        else
-        {
-            ROS_ERROR("root link: %s has a null child!", link->name.c_str());
-            return -1;
-        }
-    }
-
-    if (!includeLink)
-    {
-        return 1;
-    }
-    // ROS_INFO("Callback for link %s",link->name.c_str());
-    params->setParams(link, level);
-    int cbRet = link_cb(params);
-    if (cbRet < 0)
-    {
-        ROS_ERROR("Error parsing branch of %s", link->name.c_str());
-        return -1;
-    }
-    return cbRet;
+    CallbackVisitor visitor(link_cb, params);
+    return traverseBottomUp(link, visitor, *params, includeLink, level);
 }
 
 
 urdf_traverser::LinkPtr UrdfTraverser::getLink(const std::string& name)
 {
+    TopologyIndexConstPtr idx = getTopology();
+    if (idx)
+    {
+        int id = idx->getLinkId(name);
+        if (id == TopologyIndex::INVALID_ID) return LinkPtr();
+        return idx->getLink(id);
+    }
     LinkPtr ptr;
     this->model->getLink(name, ptr);
     return ptr;
@@ -312,6 +351,12 @@ urdf_traverser::LinkPtr UrdfTraverser::getLink(const std::string& name)
 
 urdf_traverser::LinkConstPtr UrdfTraverser::readLink(const std::string& name) const
 {
+    if (topology)
+    {
+        int id = topology->getLinkId(name);
+        if (id == TopologyIndex::INVALID_ID) return LinkConstPtr();
+        return topology->getLink(id);
+    }
     LinkPtr ptr;
     this->model->getLink(name, ptr);
     return ptr;
@@ -319,18 +364,29 @@ urdf_traverser::LinkConstPtr UrdfTraverser::readLink(const std::string& name) co
 
 urdf_traverser::JointPtr UrdfTraverser::getJoint(const std::string& name)
 {
-    JointPtr ptr;
-    if (this->model->joints_.find(name) == this->model->joints_.end()) ptr.reset();
-    else ptr = this->model->joints_.find(name)->second;
-    return ptr;
+    TopologyIndexConstPtr idx = getTopology();
+    if (idx)
+    {
+        int id = idx->getJointId(name);
+        if (id == TopologyIndex::INVALID_ID) return JointPtr();
+        return idx->getJoint(id);
+    }
+    std::map<std::string, JointPtr>::const_iterator it = this->model->joints_.find(name);
+    if (it == this->model->joints_.end()) return JointPtr();
+    return it->second;
 }
 
 urdf_traverser::JointConstPtr UrdfTraverser::readJoint(const std::string& name) const
 {
-    JointConstPtr ptr;
-    if (this->model->joints_.find(name) == this->model->joints_.end()) ptr.reset();
-    else ptr = this->model->joints_.find(name)->second;
-    return ptr;
+    if (topology)
+    {
+        int id = topology->getJointId(name);
+        if (id == TopologyIndex::INVALID_ID) return JointConstPtr();
+        return topology->getJoint(id);
+    }
+    std::map<std::string, JointPtr>::const_iterator it = this->model->joints_.find(name);
+    if (it == this->model->joints_.end()) return JointConstPtr();
+    return it->second;
 }
 
 
@@ -374,12 +430,17 @@ bool UrdfTraverser::loadModelFromFile(const std::string& urdfFilename)
 
 bool UrdfTraverser::loadModelFromXMLString(const std::string& xmlString)
 {
+    invalidateTopology();
     bool success = model->initString(xmlString);
     if (!success)
     {
         ROS_ERROR("Could not load model from XML string");
         return false;
     }
+    if (useTopologyIndex && !getTopology())
+    {
+        ROS_WARN("Could not build topology index, falling back to lookups in the model");
+    }
     return true;
 }
 
@@ -393,32 +454,68 @@ bool UrdfTraverser::loadModelFromXMLString(const std::string& xmlString)
 
 bool UrdfTraverser::getModelFromFile(const std::string& filename, std::string& xml_string) const
 {
-    std::fstream xml_file(filename.c_str(), std::fstream::in);
-    if (xml_file.is_open())
+    if (!urdf_traverser::helpers::readFromFile(filename, xml_string))
     {
-        while (xml_file.good())
-        {
-            std::string line;
-            std::getline(xml_file, line);
-            xml_string += (line + "\n");
-        }
-        xml_file.close();
-        return true;
+        ROS_ERROR("Could not read file [%s] for parsing.", filename.c_str());
+        return false;
     }
+    return true;
+}
 
-    ROS_ERROR("Could not open file [%s] for parsing.", filename.c_str());
-    return false;
+bool UrdfTraverser::saveSnapshot(const std::string& filename) const
+{
+    std::string buffer;
+    if (!urdf_traverser::writeSnapshot(*model, modelDir, buffer))
+    {
+        ROS_ERROR("Could not create snapshot of the model");
+        return false;
+    }
+    return urdf_traverser::helpers::writeToFile(buffer, filename);
+}
+
+bool UrdfTraverser::loadModelFromSnapshot(const std::string& filename)
+{
+    std::string buffer;
+    if (!urdf_traverser::helpers::readFromFile(filename, buffer))
+    {
+        ROS_ERROR("Could not read snapshot file [%s]", filename.c_str());
+        return false;
+    }
+    invalidateTopology();
+    std::string dir;
+    if (!urdf_traverser::readSnapshot(buffer, *model, dir))
+    {
+        ROS_ERROR("Could not load model from snapshot [%s]", filename.c_str());
+        return false;
+    }
+    modelDir = dir;
+    if (useTopologyIndex && !getTopology())
+    {
+        ROS_WARN("Could not build topology index, falling back to lookups in the model");
+    }
+    return true;
 }
 
 urdf_traverser::EigenTransform UrdfTraverser::getTransform(const LinkPtr& from_link,  const JointPtr& to_joint)
 {
     LinkPtr link1 = from_link;
-    LinkPtr link2;
-    this->model->getLink(to_joint->child_link_name, link2);
+    LinkPtr link2 = getChildLink(to_joint);
     if (!link1 || !link2)
     {
         ROS_ERROR("Invalid joint specifications (%s, %s), first needs parent and second child",
                   link1->name.c_str(), link2->name.c_str());
     }
+    TopologyIndexConstPtr index = getTopology();
+    if (index && link1 && link2)
+    {
+        int fromId = index->getLinkId(link1->name);
+        int toId = index->getLinkId(link2->name);
+        EigenTransform result;
+        if ((fromId != TopologyIndex::INVALID_ID) && (toId != TopologyIndex::INVALID_ID)
+                && index->getTransform(fromId, toId, result))
+        {
+            return result;
+        }
+    }
     return urdf_traverser::getTransform(link1, link2);
 }
@@ -0,0 +1,140 @@
+/**
+ * <ORGANIZATION> = Jennifer Buehler 
+ * <COPYRIGHT HOLDER> = Jennifer Buehler 
+ * 
+ * Copyright (c) 2016 Jennifer Buehler 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <ORGANIZATION> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ------------------------------------------------------------------------------
+ **/
+#include <ros/ros.h>
+#include <urdf_traverser/UrdfTraverser.h>
+#include <urdf_traverser/KinematicState.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using urdf_traverser::UrdfTraverser;
+using urdf_traverser::KinematicState;
+using urdf_traverser::LinkTransformBatch;
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "urdf_traverser_kinematics_benchmark", ros::init_options::AnonymousName);
+    ros::NodeHandle priv("~");
+
+    if (argc < 2)
+    {
+        ROS_INFO_STREAM("Usage: " << argv[0] << " <input-file> [<num-configurations>] [<from-link>]");
+        ROS_INFO_STREAM("Compares forward kinematics for <num-configurations> random joint configurations "
+                        << "(default 10000) computed one by one and as one batch.");
+        return 0;
+    }
+
+    std::string inputFile = argv[1];
+    int numConfigs = 10000;
+    std::string fromLink;
+
+    if (argc > 2)
+    {
+        numConfigs = atoi(argv[2]);
+        if (numConfigs <= 0)
+        {
+            ROS_ERROR("Number of configurations has to be positive");
+            return 1;
+        }
+    }
+    if (argc > 3)
+    {
+        fromLink = argv[3];
+    }
+
+    UrdfTraverser traverser;
+    if (!traverser.loadModelFromFile(inputFile))
+    {
+        ROS_ERROR_STREAM("Could not load file " << inputFile);
+        return 1;
+    }
+
+    KinematicState state;
+    if (!state.init(traverser, fromLink))
+    {
+        ROS_ERROR("Could not initialize kinematic state");
+        return 1;
+    }
+
+    ROS_INFO("Model has %u links and %u degrees of freedom, computing %i configurations.",
+             state.getNumLinks(), state.getNumDOF(), numConfigs);
+
+    srand(0);
+    Eigen::MatrixXd configs = Eigen::MatrixXd::Random(numConfigs, state.getNumDOF()) * M_PI;
+
+    // one by one: only setting the joint positions and computing the transforms of all links.
+    // The checksum keeps the computation from being optimized away.
+    std::vector<Eigen::VectorXd> rows(numConfigs);
+    for (int i = 0; i < numConfigs; ++i) rows[i] = configs.row(i).transpose();
+    const unsigned int lastLink = state.getNumLinks() - 1;
+    double checksum = 0;
+    ros::WallTime start = ros::WallTime::now();
+    for (int i = 0; i < numConfigs; ++i)
+    {
+        state.setJointPositions(rows[i]);
+        checksum += state.getLinkTransform(lastLink).translation().sum();
+    }
+    double singleTime = (ros::WallTime::now() - start).toSec();
+
+    // the first batch allocates the result, which is reused by the timed one
+    LinkTransformBatch batch;
+    state.computeLinkTransforms(configs, batch);
+    start = ros::WallTime::now();
+    state.computeLinkTransforms(configs, batch);
+    double batchTime = (ros::WallTime::now() - start).toSec();
+
+    // compare the results outside of the timed sections
+    double maxDiff = 0;
+    for (int i = 0; i < numConfigs; ++i)
+    {
+        state.setJointPositions(rows[i]);
+        for (unsigned int l = 0; l < state.getNumLinks(); ++l)
+        {
+            const urdf_traverser::EigenTransform& t = state.getLinkTransform(l);
+            double diff = (t.matrix() - batch.getTransform(i, l).matrix()).cwiseAbs().maxCoeff();
+            if (diff > maxDiff) maxDiff = diff;
+        }
+    }
+    ROS_DEBUG("Checksum: %f", checksum);
+
+    ROS_INFO("One by one: %f s, batch: %f s (speedup %.1f), max difference %g",
+             singleTime, batchTime, singleTime / batchTime, maxDiff);
+
+    // transforms of a long chain can differ by rounding errors, but not more than that
+    const double tolerance = 1e-9;
+    if (!(maxDiff <= tolerance))
+    {
+        ROS_ERROR("Batch transforms differ from the ones computed one by one by more than %g", tolerance);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,551 @@
+/**
+ * <ORGANIZATION> = Jennifer Buehler
+ * <COPYRIGHT HOLDER> = Jennifer Buehler
+ *
+ * Copyright (c) 2016 Jennifer Buehler
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <ORGANIZATION> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ------------------------------------------------------------------------------
+ **/
+#include <gtest/gtest.h>
+#include <urdf_traverser/UrdfTraverser.h>
+#include <urdf_traverser/Snapshot.h>
+#include <urdf_traverser/Helpers.h>
+#include <urdf_traverser/PathTable.h>
+#include <urdf_traverser/Functions.h>
+#include <urdf_traverser/TopologyIndex.h>
+#include <urdf_traverser/KinematicState.h>
+
+#define BOOST_NO_CXX11_SCOPED_ENUMS
+#include <boost/filesystem.hpp>
+#undef BOOST_NO_CXX11_SCOPED_ENUMS
+
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using urdf_traverser::UrdfTraverser;
+using urdf_traverser::LinkPtr;
+using urdf_traverser::JointPtr;
+using urdf_traverser::EigenTransform;
+using urdf_traverser::TopologyIndex;
+using urdf_traverser::TopologyIndexConstPtr;
+using urdf_traverser::KinematicState;
+using urdf_traverser::LinkTransformBatch;
+using urdf_traverser::helpers::PathTable;
+
+namespace
+{
+
+const char* const SNAPSHOT_TEST_URDF =
+    "<robot name=\"test\">"
+    "  <link name=\"base\"/>"
+    "  <link name=\"fixed\">"
+    "    <visual><geometry><box size=\"1 2 3\"/></geometry></visual>"
+    "  </link>"
+    "  <link name=\"arm\"/>"
+    "  <link name=\"hand\"/>"
+    "  <joint name=\"base_fixed\" type=\"fixed\">"
+    "    <parent link=\"base\"/><child link=\"fixed\"/><origin xyz=\"0 0 1\"/>"
+    "  </joint>"
+    "  <joint name=\"fixed_arm\" type=\"revolute\">"
+    "    <parent link=\"fixed\"/><child link=\"arm\"/><origin xyz=\"1 0 0\"/><axis xyz=\"0 0 1\"/>"
+    "    <limit lower=\"-1\" upper=\"1\" effort=\"1\" velocity=\"1\"/>"
+    "  </joint>"
+    "  <joint name=\"arm_hand\" type=\"continuous\">"
+    "    <parent link=\"arm\"/><child link=\"hand\"/><origin xyz=\"0 1 0\"/><axis xyz=\"1 0 0\"/>"
+    "  </joint>"
+    "</robot>";
+
+// Two branches below the base link, with rotated joint origins.
+const char* const BRANCHED_TEST_URDF =
+    "<robot name=\"test\">"
+    "  <link name=\"base\"/>"
+    "  <link name=\"a\"/>"
+    "  <link name=\"a1\"/>"
+    "  <link name=\"b\"/>"
+    "  <link name=\"b1\"/>"
+    "  <joint name=\"base_a\" type=\"revolute\">"
+    "    <parent link=\"base\"/><child link=\"a\"/><origin xyz=\"0.1 0.2 0.3\" rpy=\"0.3 0 0.5\"/>"
+    "    <axis xyz=\"0 0 1\"/><limit lower=\"-3\" upper=\"3\" effort=\"1\" velocity=\"1\"/>"
+    "  </joint>"
+    "  <joint name=\"a_a1\" type=\"prismatic\">"
+    "    <parent link=\"a\"/><child link=\"a1\"/><origin xyz=\"1 0 0\" rpy=\"0 0.4 0\"/>"
+    "    <axis xyz=\"0 1 0\"/><limit lower=\"-1\" upper=\"1\" effort=\"1\" velocity=\"1\"/>"
+    "  </joint>"
+    "  <joint name=\"base_b\" type=\"fixed\">"
+    "    <parent link=\"base\"/><child link=\"b\"/><origin xyz=\"0 -1 0\" rpy=\"0.2 0.1 -0.3\"/>"
+    "  </joint>"
+    "  <joint name=\"b_b1\" type=\"continuous\">"
+    "    <parent link=\"b\"/><child link=\"b1\"/><origin xyz=\"0 0 0.5\" rpy=\"-0.5 0 0\"/>"
+    "    <axis xyz=\"1 0 0\"/>"
+    "  </joint>"
+    "</robot>";
+
+void expectTransformNear(const EigenTransform& expected, const EigenTransform& actual)
+{
+    EXPECT_TRUE(expected.matrix().isApprox(actual.matrix(), 1e-12))
+            << "Expected" << std::endl << expected.matrix() << std::endl
+            << "Actual" << std::endl << actual.matrix();
+}
+
+/**
+ * Computes the Jacobian of \e tipLink relative to \e baseLink (see KinematicState::getJacobian())
+ * with central differences of the transform between the links at joint positions \e q.
+ */
+Eigen::MatrixXd numericJacobian(KinematicState& state, unsigned int baseLink, unsigned int tipLink,
+                                const Eigen::VectorXd& q)
+{
+    const double h = 1e-6;
+    Eigen::MatrixXd jacobian(6, q.size());
+    state.setJointPositions(q);
+    const Eigen::Matrix3d rotation = state.getTransform(baseLink, tipLink).linear();
+    for (unsigned int j = 0; j < q.size(); ++j)
+    {
+        Eigen::VectorXd qPlus = q;
+        qPlus[j] += h;
+        state.setJointPositions(qPlus);
+        const EigenTransform plus = state.getTransform(baseLink, tipLink);
+        Eigen::VectorXd qMinus = q;
+        qMinus[j] -= h;
+        state.setJointPositions(qMinus);
+        const EigenTransform minus = state.getTransform(baseLink, tipLink);
+        jacobian.block<3, 1>(0, j) = (plus.translation() - minus.translation()) / (2 * h);
+        // the angular velocity is the skew-symmetric matrix dR/dq * R^T
+        const Eigen::Matrix3d w = (plus.linear() - minus.linear()) / (2 * h) * rotation.transpose();
+        jacobian.block<3, 1>(3, j) = Eigen::Vector3d(w(2, 1), w(0, 2), w(1, 0));
+    }
+    state.setJointPositions(q);
+    return jacobian;
+}
+
+/**
+ * Expects that the links have the same names, parents and children, recursively.
+ */
+void expectSameTree(const LinkPtr& expected, const LinkPtr& actual)
+{
+    ASSERT_TRUE(expected && actual);
+    EXPECT_EQ(expected->name, actual->name);
+    LinkPtr expectedParent = expected->getParent();
+    LinkPtr actualParent = actual->getParent();
+    EXPECT_EQ(expectedParent ? expectedParent->name : "", actualParent ? actualParent->name : "");
+    ASSERT_EQ(expected->child_joints.size(), actual->child_joints.size()) << "Link " << expected->name;
+    ASSERT_EQ(expected->child_links.size(), actual->child_links.size()) << "Link " << expected->name;
+    for (unsigned int i = 0; i < expected->child_joints.size(); ++i)
+    {
+        EXPECT_EQ(expected->child_joints[i]->name, actual->child_joints[i]->name);
+        EXPECT_EQ(actual->name, actual->child_joints[i]->parent_link_name);
+        expectSameTree(expected->child_links[i], actual->child_links[i]);
+    }
+}
+
+/**
+ * Replaces the keys of \e replacements in \e text by trying all keys at each position:
+ * the longest key at the leftmost position is replaced, and the search continues after it.
+ */
+std::string naiveReplaceAll(const std::string& text, const std::map<std::string, std::string>& replacements)
+{
+    std::string ret;
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+        std::map<std::string, std::string>::const_iterator longest = replacements.end();
+        for (std::map<std::string, std::string>::const_iterator it = replacements.begin(); it != replacements.end(); ++it)
+        {
+            if (it->first.empty() || (text.compare(pos, it->first.size(), it->first) != 0)) continue;
+            if ((longest == replacements.end()) || (it->first.size() > longest->first.size())) longest = it;
+        }
+        if (longest == replacements.end())
+        {
+            ret += text[pos++];
+            continue;
+        }
+        ret += longest->second;
+        pos += longest->first.size();
+    }
+    return ret;
+}
+
+/**
+ * Returns a random string of length \e minLength to \e maxLength over a small alphabet,
+ * so that the patterns overlap often.
+ */
+std::string randomString(std::mt19937& rng, int minLength, int maxLength)
+{
+    std::uniform_int_distribution<int> length(minLength, maxLength);
+    std::uniform_int_distribution<int> letter(0, 2);
+    std::string ret(length(rng), 'a');
+    for (std::string::iterator c = ret.begin(); c != ret.end(); ++c)
+    {
+        *c += letter(rng);
+    }
+    return ret;
+}
+
+/**
+ * Compares the results of all methods of \e table with the functions of the same name
+ * in Helpers.h, for all pairs of \e paths and for all of them together.
+ */
+void expectSameAsHelpers(PathTable& table, const std::vector<std::string>& paths)
+{
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        for (size_t k = 0; k < paths.size(); ++k)
+        {
+            const std::string& p1 = paths[i];
+            const std::string& p2 = paths[k];
+            std::string expected, actual;
+            if (urdf_traverser::helpers::isDirectoryPath(p1))
+            {
+                bool success = urdf_traverser::helpers::getSubdirPath(p1, p2, expected);
+                EXPECT_EQ(success, table.getSubdirPath(p1, p2, actual)) << "getSubdirPath " << p1 << ", " << p2;
+                if (success)
+                {
+                    EXPECT_EQ(expected, actual) << "getSubdirPath " << p1 << ", " << p2;
+                }
+            }
+
+            ASSERT_TRUE(urdf_traverser::helpers::getRelativeDirectory(p1, p2, expected));
+            ASSERT_TRUE(table.getRelativeDirectory(p1, p2, actual));
+            EXPECT_EQ(expected, actual) << "getRelativeDirectory " << p1 << ", " << p2;
+
+            std::set<std::string> pair;
+            pair.insert(p1);
+            pair.insert(p2);
+            ASSERT_TRUE(urdf_traverser::helpers::getCommonParentPath(pair, expected));
+            ASSERT_TRUE(table.getCommonParentPath(pair, actual));
+            EXPECT_EQ(expected, actual) << "getCommonParentPath " << p1 << ", " << p2;
+        }
+    }
+    std::set<std::string> all(paths.begin(), paths.end());
+    std::string expected, actual;
+    ASSERT_TRUE(urdf_traverser::helpers::getCommonParentPath(all, expected));
+    ASSERT_TRUE(table.getCommonParentPath(all, actual));
+    EXPECT_EQ(expected, actual);
+}
+
+// Paths within one directory, as file references of a model would be.
+// A name without trailing separator is a file.
+const char* const TEST_PATHS[] =
+{
+    "a/b/c.dae", "a/b/", "a/b/d/e.png", "a/b/d/", "a/x/", "a/x/y.png", "a/b", "a/", "a/z.png", "b/", "b/y.png"
+};
+
+}  // namespace
+
+TEST(HelpersTest, ReplaceAllLeftmostLongest)
+{
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<int> numPatterns(1, 4);
+    for (unsigned int i = 0; i < 20000; ++i)
+    {
+        std::map<std::string, std::string> replacements;
+        for (int p = numPatterns(rng); p > 0; --p)
+        {
+            // replacements use other letters, so searching replaced text again would show
+            std::string replacement = randomString(rng, 0, 3);
+            for (std::string::iterator c = replacement.begin(); c != replacement.end(); ++c)
+            {
+                *c += 'x' - 'a';
+            }
+            replacements[randomString(rng, 1, 4)] = replacement;
+        }
+        const std::string text = randomString(rng, 0, 30);
+        ASSERT_EQ(naiveReplaceAll(text, replacements), urdf_traverser::helpers::replaceAll(text, replacements))
+                << "Case " << i << ", text " << text;
+    }
+}
+
+TEST(PathTableTest, AbsolutePathsMatchHelpers)
+{
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < sizeof(TEST_PATHS) / sizeof(TEST_PATHS[0]); ++i)
+    {
+        paths.push_back(std::string("/models/") + TEST_PATHS[i]);
+    }
+    PathTable table;
+    expectSameAsHelpers(table, paths);
+
+    std::string result;
+    ASSERT_TRUE(table.getSubdirPath("/models/a/", "/models/a/", result));
+    EXPECT_EQ(".", result);
+    ASSERT_TRUE(table.getRelativeDirectory("/models/a/b/", "/models/a/b/", result));
+    EXPECT_EQ(".", result);
+}
+
+TEST(PathTableTest, RelativePathsMatchHelpers)
+{
+    const boost::filesystem::path startDir = boost::filesystem::current_path();
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < sizeof(TEST_PATHS) / sizeof(TEST_PATHS[0]); ++i)
+    {
+        paths.push_back(TEST_PATHS[i]);
+        // the same path made absolute, which the relative paths can be mixed with
+        paths.push_back((startDir / TEST_PATHS[i]).string());
+    }
+    PathTable table;
+    expectSameAsHelpers(table, paths);
+
+    // relative paths are resolved against the current directory at the time of the call
+    boost::filesystem::current_path(startDir.parent_path());
+    std::string result;
+    EXPECT_TRUE(table.getSubdirPath(startDir.parent_path().string() + "/", "a/b/c.dae", result));
+    EXPECT_EQ("a/b/c.dae", result);
+    expectSameAsHelpers(table, paths);
+    boost::filesystem::current_path(startDir);
+}
+
+TEST(SnapshotTest, RoundTrip)
+{
+    UrdfTraverser traverser;
+    ASSERT_TRUE(traverser.loadModelFromXMLString(SNAPSHOT_TEST_URDF));
+    urdf_traverser::ModelPtr model = traverser.getModel();
+
+    std::string buffer;
+    ASSERT_TRUE(urdf_traverser::writeSnapshot(*model, "/model/dir", buffer));
+    urdf::Model result;
+    std::string modelDir;
+    ASSERT_TRUE(urdf_traverser::readSnapshot(buffer, result, modelDir));
+    EXPECT_EQ("/model/dir", modelDir);
+    EXPECT_EQ(model->links_.size(), result.links_.size());
+    EXPECT_EQ(model->joints_.size(), result.joints_.size());
+    expectSameTree(model->root_link_, result.root_link_);
+}
+
+// Joining fixed links moves the child joints of a link to its parent, but the detached
+// link keeps its old children. The snapshot must only contain the new connections.
+TEST(SnapshotTest, RoundTripWithDetachedLink)
+{
+    UrdfTraverser traverser;
+    ASSERT_TRUE(traverser.loadModelFromXMLString(SNAPSHOT_TEST_URDF));
+    urdf_traverser::ModelPtr model = traverser.getModel();
+
+    // re-link "arm" to "base" like urdf_transform::joinFixedLinks() does
+    LinkPtr base = model->links_["base"];
+    LinkPtr arm = model->links_["arm"];
+    JointPtr joint = model->joints_["fixed_arm"];
+    base->child_joints.clear();
+    base->child_links.clear();
+    model->joints_.erase("base_fixed");
+    joint->parent_link_name = base->name;
+    base->child_joints.push_back(joint);
+    base->child_links.push_back(arm);
+    arm->setParent(base);
+    ASSERT_EQ(1u, model->links_["fixed"]->child_joints.size());
+
+    std::string buffer;
+    ASSERT_TRUE(urdf_traverser::writeSnapshot(*model, "", buffer));
+    urdf::Model result;
+    std::string modelDir;
+    ASSERT_TRUE(urdf_traverser::readSnapshot(buffer, result, modelDir));
+    expectSameTree(model->root_link_, result.root_link_);
+    EXPECT_TRUE(result.links_["fixed"]->child_joints.empty());
+    EXPECT_TRUE(result.links_["fixed"]->child_links.empty());
+
+    // a second round trip doesn't change anything
+    std::string buffer2;
+    ASSERT_TRUE(urdf_traverser::writeSnapshot(result, "", buffer2));
+    EXPECT_EQ(buffer, buffer2);
+}
+
+TEST(TopologyIndexTest, CommonAncestor)
+{
+    UrdfTraverser traverser;
+    ASSERT_TRUE(traverser.loadModelFromXMLString(BRANCHED_TEST_URDF));
+    TopologyIndexConstPtr index = traverser.getTopology();
+    ASSERT_TRUE(index);
+    const int base = index->getLinkId("base");
+    const int a = index->getLinkId("a");
+    const int a1 = index->getLinkId("a1");
+    const int b = index->getLinkId("b");
+    const int b1 = index->getLinkId("b1");
+    EXPECT_EQ(base, index->getCommonAncestor(a1, b1));
+    EXPECT_EQ(base, index->getCommonAncestor(a, b));
+    EXPECT_EQ(a, index->getCommonAncestor(a, a1));
+    EXPECT_EQ(a, index->getCommonAncestor(a1, a));
+    EXPECT_EQ(b1, index->getCommonAncestor(b1, b1));
+    EXPECT_EQ(base, index->getCommonAncestor(base, b1));
+}
+
+TEST(TopologyIndexTest, TransformMatchesChain)
+{
+    UrdfTraverser traverser;
+    ASSERT_TRUE(traverser.loadModelFromXMLString(BRANCHED_TEST_URDF));
+    TopologyIndexConstPtr index = traverser.getTopology();
+    ASSERT_TRUE(index);
+    const char* const links[] = {"base", "a", "a1", "b", "b1"};
+    for (unsigned int i = 0; i < 5; ++i)
+    {
+        for (unsigned int k = 0; k < 5; ++k)
+        {
+            SCOPED_TRACE(std::string(links[i]) + " to " + links[k]);
+            const int from = index->getLinkId(links[i]);
+            const int to = index->getLinkId(links[k]);
+            EigenTransform result;
+            ASSERT_TRUE(index->getTransform(from, to, result));
+            if (index->isAncestor(from, to))
+            {
+                expectTransformNear(urdf_traverser::getTransform(index->getLink(from), index->getLink(to)), result);
+            }
+            else
+            {
+                // go via the base link, which is an ancestor of both
+                const LinkPtr& baseLink = index->getLink(index->getLinkId("base"));
+                EigenTransform expected = urdf_traverser::getTransform(baseLink, index->getLink(from)).inverse()
+                                          * urdf_traverser::getTransform(baseLink, index->getLink(to));
+                expectTransformNear(expected, result);
+            }
+        }
+    }
+}
+
+TEST(TopologyIndexTest, DetachedLinkIsNotConnected)
+{
+    UrdfTraverser traverser;
+    ASSERT_TRUE(traverser.loadModelFromXMLString(SNAPSHOT_TEST_URDF));
+    urdf_traverser::ModelPtr model = traverser.getModel();
+
+    // re-link "arm" to "base", so that "fixed" is not in the tree any more
+    LinkPtr base = model->links_["base"];
+    LinkPtr arm = model->links_["arm"];
+    JointPtr joint = model->joints_["fixed_arm"];
+    base->child_joints.clear();
+    base->child_links.clear();
+    model->joints_.erase("base_fixed");
+    joint->parent_link_name = base->name;
+    base->child_joints.push_back(joint);
+    base->child_links.push_back(arm);
+    arm->setParent(base);
+    traverser.invalidateTopology();
+
+    TopologyIndexConstPtr index = traverser.getTopology();
+    ASSERT_TRUE(index);
+    const int fixed = index->getLinkId("fixed");
+    const int hand = index->getLinkId("hand");
+    EXPECT_EQ(TopologyIndex::INVALID_ID, index->getCommonAncestor(fixed, hand));
+    EXPECT_EQ(TopologyIndex::INVALID_ID, index->getCommonAncestor(index->getLinkId("base"), fixed));
+    EigenTransform result;
+    EXPECT_FALSE(index->getTransform(fixed, hand, result));
+    EXPECT_FALSE(index->getTransform(hand, fixed, result));
+    EXPECT_FALSE(traverser.getTransform("fixed", "hand", result));
+    EXPECT_TRUE(index->getTransform(index->getLinkId("base"), hand, result));
+}
+
+TEST(TopologyIndexTest, TransformAfterOriginChange)
+{
+    UrdfTraverser traverser;
+    ASSERT_TRUE(traverser.loadModelFromXMLString(BRANCHED_TEST_URDF));
+    ASSERT_TRUE(traverser.getTopology());
+
+    urdf::Pose& origin = traverser.getModel()->joints_["base_a"]->parent_to_joint_origin_transform;
+    origin.position = urdf::Vector3(0.5, -0.25, 2);
+    origin.rotation.setFromRPY(0.1, 0.7, -0.2);
+    traverser.invalidateTopology();
+
+    TopologyIndexConstPtr index = traverser.getTopology();
+    ASSERT_TRUE(index);
+    EigenTransform result;
+    ASSERT_TRUE(index->getTransform(index->getLinkId("base"), index->getLinkId("a1"), result));
+    expectTransformNear(urdf_traverser::getTransform(index->getLink(index->getLinkId("base")),
+                        index->getLink(index->getLinkId("a1"))), result);
+    ASSERT_TRUE(traverser.getTransform("b1", "a1", result));
+    EigenTransform expected = urdf_traverser::getTransform(traverser.getModel()->links_["base"], traverser.getModel()->links_["b1"]).inverse()
+                              * urdf_traverser::getTransform(traverser.getModel()->links_["base"], traverser.getModel()->links_["a1"]);
+    expectTransformNear(expected, result);
+}
+
+// base -> a (revolute) -> a1 (prismatic) is a chain, and from b1 to a1 the continuous joint
+// b_b1 moves the base link b1, which is not an ancestor of a1.
+TEST(KinematicStateTest, JacobianMatchesFiniteDifferences)
+{
+    UrdfTraverser traverser;
+    ASSERT_TRUE(traverser.loadModelFromXMLString(BRANCHED_TEST_URDF));
+    KinematicState state;
+    ASSERT_TRUE(state.init(traverser));
+    ASSERT_EQ(3u, state.getNumDOF());
+
+    const char* const cases[][2] = {{"base", "a1"}, {"a", "a1"}, {"b1", "a1"}, {"a1", "b1"}};
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<double> position(-1.5, 1.5);
+    for (unsigned int i = 0; i < 10; ++i)
+    {
+        Eigen::VectorXd q(state.getNumDOF());
+        for (unsigned int j = 0; j < q.size(); ++j) q[j] = position(rng);
+        for (unsigned int c = 0; c < 4; ++c)
+        {
+            SCOPED_TRACE(std::string(cases[c][0]) + " to " + cases[c][1]);
+            const int base = state.getLinkIndex(cases[c][0]);
+            const int tip = state.getLinkIndex(cases[c][1]);
+            ASSERT_GE(base, 0);
+            ASSERT_GE(tip, 0);
+            const Eigen::MatrixXd expected = numericJacobian(state, base, tip, q);
+            Eigen::MatrixXd jacobian(6, state.getNumDOF());
+            ASSERT_TRUE(state.getJacobian(base, tip, jacobian));
+            EXPECT_TRUE(jacobian.isApprox(expected, 1e-6))
+                    << "Expected" << std::endl << expected << std::endl << "Actual" << std::endl << jacobian;
+        }
+    }
+}
+
+TEST(KinematicStateTest, BatchJacobiansMatchFiniteDifferences)
+{
+    UrdfTraverser traverser;
+    ASSERT_TRUE(traverser.loadModelFromXMLString(BRANCHED_TEST_URDF));
+    KinematicState state;
+    ASSERT_TRUE(state.init(traverser));
+
+    // more than one block, and a partly filled last block
+    const unsigned int numConfigs = LinkTransformBatch::BLOCK_SIZE + 5;
+    srand(0);
+    const Eigen::MatrixXd configurations = Eigen::MatrixXd::Random(numConfigs, state.getNumDOF()) * 1.5;
+    LinkTransformBatch transforms;
+    ASSERT_TRUE(state.computeLinkTransforms(configurations, transforms));
+
+    const char* const cases[][2] = {{"base", "a1"}, {"b1", "a1"}};
+    for (unsigned int c = 0; c < 2; ++c)
+    {
+        SCOPED_TRACE(std::string(cases[c][0]) + " to " + cases[c][1]);
+        const int base = state.getLinkIndex(cases[c][0]);
+        const int tip = state.getLinkIndex(cases[c][1]);
+        Eigen::MatrixXd jacobians(numConfigs, 6 * state.getNumDOF());
+        ASSERT_TRUE(state.computeJacobians(transforms, base, tip, jacobians));
+        for (unsigned int i = 0; i < numConfigs; ++i)
+        {
+            const Eigen::MatrixXd expected = numericJacobian(state, base, tip, configurations.row(i).transpose());
+            // entry (r, j) is in column 6 * j + r
+            const Eigen::MatrixXd jacobian = Eigen::Map<const Eigen::MatrixXd, 0, Eigen::InnerStride<> >(
+                                                 jacobians.data() + i, 6, state.getNumDOF(), Eigen::InnerStride<>(numConfigs));
+            EXPECT_TRUE(jacobian.isApprox(expected, 1e-6)) << "Configuration " << i << std::endl
+                    << "Expected" << std::endl << expected << std::endl << "Actual" << std::endl << jacobian;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
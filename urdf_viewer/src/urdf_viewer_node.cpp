@@ -95,9 +95,25 @@ int main(int argc, char *argv[])
     priv.param<float>("visual_corr_axis_angle", visCorrAxAngle, visCorrAxAngle);
     Urdf2Inventor::EigenTransform addVisualTrans(Eigen::AngleAxisd(visCorrAxAngle * M_PI / 180, Eigen::Vector3d(visCorrAxX, visCorrAxY, visCorrAxZ)));
 
+    // Preset of post-processing steps applied to the meshes when importing them:
+    // "none", "fast", "render-optimized" or "collision-minimal" (see urdf2inventor::MeshConversionOptions)
+    urdf2inventor::MeshConversionOptions meshOptions;
+    std::string postProcessing = "fast";
+    priv.param<std::string>("mesh_postprocessing", postProcessing, postProcessing);
+    if (!urdf2inventor::MeshConversionOptions::getPostProcessing(postProcessing, meshOptions.postProcessing))
+    {
+        ROS_ERROR_STREAM("Unknown mesh_postprocessing preset " << postProcessing);
+        return 0;
+    }
+    // Ratios of the number of triangles of the meshes for lower levels of detail, e.g. [0.25, 0.05],
+    // and the distances from the viewer beyond which they are displayed.
+    priv.param<std::vector<float> >("lod_ratios", meshOptions.lodRatios, meshOptions.lodRatios);
+    priv.param<std::vector<float> >("lod_ranges", meshOptions.lodRanges, meshOptions.lodRanges);
+
     bool success = true;
     urdf2inventor::Urdf2Inventor::UrdfTraverserPtr traverser(new urdf_traverser::UrdfTraverser());
     Urdf2Inventor converter(traverser, 1);
+    converter.setMeshConversionOptions(meshOptions);
     InventorViewer view;
     view.init("WindowName");
     if (isURDF)